@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -23,14 +23,26 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 
+include(core.pri)
+
 SOURCES += main.cpp\
         mainwindow.cpp \
-    alias.cpp \
-    add_alias_dialog.cpp
+    add_alias_dialog.cpp \
+    write_coalescer.cpp \
+    domain_model.cpp \
+    domain_browser_dialog.cpp \
+    batch_runner.cpp \
+    statistics_dialog.cpp \
+    hosts_watcher.cpp
 
 HEADERS  += mainwindow.h \
-    alias.hpp \
-    add_alias_dialog.hpp
+    add_alias_dialog.hpp \
+    write_coalescer.hpp \
+    domain_model.hpp \
+    domain_browser_dialog.hpp \
+    batch_runner.hpp \
+    statistics_dialog.hpp \
+    hosts_watcher.hpp
 
 FORMS    += mainwindow.ui
 
@@ -9,8 +9,8 @@
 
 QString title = "Add Alias";
 
-add_alias_dialog::add_alias_dialog( QMap<QString, Alias> &alias, QWidget *parent ): QDialog{ parent },
-    aliases{ alias }, name_line_edit{ nullptr }, ip_address_line_edit{ nullptr }
+add_alias_dialog::add_alias_dialog( AliasSnapshotPtr snapshot, QWidget *parent ): QDialog{ parent },
+    aliases{ std::move( snapshot ) }, name_line_edit{ nullptr }, ip_address_line_edit{ nullptr }
 {
     QGridLayout *layout = new QGridLayout();
     layout->addWidget( new QLabel( "Name" ), 0, 0 );
@@ -37,11 +37,16 @@ add_alias_dialog::add_alias_dialog( QMap<QString, Alias> &alias, QWidget *parent
             return;
         }
 
-        if( aliases.contains( label_name ) ){
+        IpAddress address {};
+        if( !IpAddress::Parse( ip_address, address ) ){
+            QMessageBox::critical( this, title, ip_address + " is not a valid IPv4 or IPv6 address" );
+            return;
+        }
+
+        if( aliases->aliases.contains( label_name ) ){
             QMessageBox::critical( this, title, "Alias already exist" );
             return;
         }
-        aliases.insert( label_name, Alias{ label_name, ip_address } );
         QMessageBox::information( this, title, "Alias added successfully" );
         this->accept();
     } );
@@ -51,7 +56,14 @@ add_alias_dialog::add_alias_dialog( QMap<QString, Alias> &alias, QWidget *parent
     this->setWindowTitle( title );
 }
 
-QString add_alias_dialog::Ip() const { return ip_address_line_edit->text(); }
-QString add_alias_dialog::Label() const { return name_line_edit->text(); }
+QString add_alias_dialog::Ip() const { return ip_address_line_edit->text().trimmed(); }
+QString add_alias_dialog::Label() const { return name_line_edit->text().trimmed(); }
+
+IpAddress add_alias_dialog::Address() const
+{
+    IpAddress address {};
+    IpAddress::Parse( Ip(), address );
+    return address;
+}
 
 #undef SHOW_CMESSAGE
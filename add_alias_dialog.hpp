@@ -3,7 +3,7 @@
 
 #include <QDialog>
 #include <QString>
-#include "alias.hpp"
+#include "alias_snapshot.hpp"
 
 // forward declarations
 class QWidget;
@@ -17,11 +17,14 @@ private:
     QLineEdit   *name_line_edit;
     QLineEdit   *ip_address_line_edit;
 public:
-    add_alias_dialog( QMap<QString, Alias> & alias, QWidget *parent = nullptr );
+    // only checks the input against `snapshot`, the caller adds the accepted one
+    add_alias_dialog( AliasSnapshotPtr snapshot, QWidget *parent = nullptr );
     QString Label() const;
     QString Ip() const;
+    IpAddress Address() const;
 
-    QMap<QString, Alias> &aliases;
+    // the version the dialog was opened on, unaffected by whatever the store does meanwhile
+    AliasSnapshotPtr const aliases;
 };
 
 #endif // ADD_ALIAS_DIALOG_HPP
@@ -1,23 +1,107 @@
 #include "alias.hpp"
+#include <QAtomicInteger>
+#include <algorithm>
 
-Alias::Alias( const QString &alias_name, const QString &ip_address):
-    name{ alias_name }, ip{ ip_address }, domain_names {}{
+namespace {
+    QAtomicInteger<quint64> s_last_revision{ 0 };
+
+    quint64 NextRevision()
+    {
+        return ++s_last_revision;
+    }
+}
+
+Alias::Alias(): name{}, ip{}, has_address{ true }, unparsed_ip{}, domain_ids{}, wildcards{}, revision{ NextRevision() }
+{
+}
+
+Alias::Alias( const QString &alias_name, IpAddress const &ip_address ):
+    name{ alias_name }, ip{ ip_address }, has_address{ true }, unparsed_ip {}, domain_ids {}, wildcards {},
+    revision{ NextRevision() }{
+}
+
+Alias Alias::Unparsed( QString const & alias_name, QString const & ip_text )
+{
+    Alias alias{ alias_name, IpAddress{} };
+    alias.has_address = false;
+    alias.unparsed_ip = ip_text;
+    return alias;
 }
 
 QString const & Alias::Name() const { return name; }
-QString const & Alias::Address() const { return ip; }
+IpAddress const & Alias::Address() const { return ip; }
+bool Alias::HasAddress() const { return has_address; }
+QString const & Alias::UnparsedAddress() const { return unparsed_ip; }
+
+QString Alias::AddressText() const {
+    return has_address ? ip.ToString() : unparsed_ip;
+}
+
+void Alias::SetAddress( IpAddress const & ip_address )
+{
+    if( has_address && ip == ip_address ) return;
+    ip = ip_address;
+    has_address = true;
+    unparsed_ip.clear();
+    revision = NextRevision();
+}
+
+std::vector<DomainId> const & Alias::GetDomainNames() const {
+    return domain_ids;
+}
 
-std::set<QString> const & Alias::GetDomainNames() const {
-    return domain_names;
+bool Alias::HasDomain( DomainId id ) const {
+    return std::binary_search( domain_ids.cbegin(), domain_ids.cend(), id );
 }
 
 void Alias::InsertDomainName( QString const &domain_name ){
-    domain_names.insert( domain_name );
+    InsertDomain( DomainPool::Global().Intern( domain_name ) );
+}
+
+void Alias::InsertDomain( DomainId id ){
+    auto iter = std::lower_bound( domain_ids.begin(), domain_ids.end(), id );
+    if( iter == domain_ids.end() || *iter != id ){
+        domain_ids.insert( iter, id );
+        revision = NextRevision();
+    }
 }
 
-bool Alias::IsEmptyDomain() const { return domain_names.empty(); }
+bool Alias::IsEmptyDomain() const { return domain_ids.empty(); }
 void Alias::RemoveDomainName( QString const &domain_name)
 {
-    domain_names.erase( domain_names.find( domain_name ) );
+    DomainId id {};
+    if( DomainPool::Global().Find( domain_name, id ) ) RemoveDomain( id );
+}
+
+void Alias::RemoveDomain( DomainId id )
+{
+    auto iter = std::lower_bound( domain_ids.begin(), domain_ids.end(), id );
+    if( iter != domain_ids.end() && *iter == id ){
+        domain_ids.erase( iter );
+        revision = NextRevision();
+    }
 }
 
+void Alias::SetDomains( std::vector<DomainId> ids )
+{
+    std::sort( ids.begin(), ids.end() );
+    ids.erase( std::unique( ids.begin(), ids.end() ), ids.end() );
+    if( ids == domain_ids ) return;
+    domain_ids.swap( ids );
+    revision = NextRevision();
+}
+
+QStringList const & Alias::Wildcards() const { return wildcards; }
+quint64 Alias::Revision() const { return revision; }
+
+void Alias::InsertWildcard( QString const & pattern )
+{
+    if( wildcards.contains( pattern ) ) return;
+    wildcards.append( pattern );
+    revision = NextRevision();
+}
+
+void Alias::RemoveWildcard( QString const & pattern )
+{
+    if( wildcards.removeAll( pattern ) != 0 ) revision = NextRevision();
+}
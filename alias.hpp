@@ -2,37 +2,49 @@
 #define ALIAS_HPP
 
 #include <QStringList>
-#include <set>
-
-// template specialization for std::set<QString>
-
-namespace std {
-    template<>
-    struct less<QString> {
-        using result_type = bool;
-        using first_argument_type = QString;
-        using second_argument_type = QString;
-
-        result_type operator()( QString const & lhs, QString const & rhs ) const {
-            return lhs < rhs;
-        }
-    };
-}
+#include <vector>
+#include "domain_pool.hpp"
+#include "ip_address.hpp"
 
 class Alias
 {
-    QString             name;
-    QString             ip;
-    std::set<QString>   domain_names;
+    QString               name;
+    IpAddress             ip;
+    bool                  has_address;
+    QString               unparsed_ip; // as written, when it isn't an address ip could hold
+    std::vector<DomainId> domain_ids; // sorted, names live in DomainPool::Global()
+    QStringList           wildcards;  // "*.staging.corp" rules owned by this alias
+    quint64               revision;   // new on every change, copies share it
 public:
-    Alias( QString const & alias_name, QString const & ip_address );
-    Alias() = default;
-    QString const & Address() const;
+    Alias( QString const & alias_name, IpAddress const & ip_address );
+    Alias();
+    // keeps an address IpAddress can't parse( fe80::1%eth0 ) as it was written, so nothing
+    // the user typed is lost. Such an alias stays out of the hosts file and the DNS table
+    // until SetAddress gives it a usable one
+    static Alias Unparsed( QString const & alias_name, QString const & ip_text );
+    IpAddress const & Address() const;
+    bool            HasAddress() const;
+    // as written, for an Unparsed alias
+    QString const & UnparsedAddress() const;
+    // what config.json holds: the address, or the text it couldn't be parsed from
+    QString         AddressText() const;
+    void            SetAddress( IpAddress const & ip_address );
     QString const & Name() const;
     bool            IsEmptyDomain() const;
+    bool            HasDomain( DomainId id ) const;
     void            InsertDomainName( QString const & domain_name );
+    void            InsertDomain( DomainId id );
     void            RemoveDomainName( QString const & domain_name );
-    std::set<QString> const &GetDomainNames() const;
+    void            RemoveDomain( DomainId id );
+    // replaces every domain at once, in any order
+    void            SetDomains( std::vector<DomainId> ids );
+    std::vector<DomainId> const &GetDomainNames() const;
+    QStringList const & Wildcards() const;
+    // two aliases with the same revision have the same domains and rules, so whatever was
+    // rendered from one is still good for the other
+    quint64         Revision() const;
+    void            InsertWildcard( QString const & pattern );
+    void            RemoveWildcard( QString const & pattern );
 };
 
 #endif // ALIAS_HPP
@@ -0,0 +1,58 @@
+#include "alias_snapshot.hpp"
+#include <atomic>
+
+AliasSnapshotPublisher::AliasSnapshotPublisher():
+    current{ std::make_shared<AliasSnapshot const>( AliasSnapshot{ 0, {}, {} } ) }
+{
+}
+
+AliasSnapshotPublisher::AliasSnapshotPublisher( AliasSnapshotPublisher && other ): current{ other.Current() }
+{
+}
+
+AliasSnapshotPublisher & AliasSnapshotPublisher::operator=( AliasSnapshotPublisher && other )
+{
+    if( &other == this ) return *this;
+    AliasSnapshotPtr const source = other.Current();
+    quint64 const version = qMax( source->version, Current()->version ) + 1;
+    // the alias nodes and the map are shared with the source, only the header is new
+    std::atomic_store( &current, std::make_shared<AliasSnapshot const>(
+                           AliasSnapshot{ version, source->hosts_file_path, source->aliases } ) );
+    return *this;
+}
+
+AliasSnapshotPtr AliasSnapshotPublisher::Current() const
+{
+    return std::atomic_load( &current );
+}
+
+AliasSnapshotPtr AliasSnapshotPublisher::Publish( QMap<QString, Alias> const & aliases, QString const & hosts_file_path )
+{
+    // the writer is the only one storing, its own load can't race with anything
+    AliasSnapshotPtr const previous = std::atomic_load( &current );
+    QMap<QString, AliasSnapshot::AliasPtr> const & old_aliases = previous->aliases;
+
+    // both maps are in key order, so the old node of an alias is found by walking alongside
+    QMap<QString, AliasSnapshot::AliasPtr> new_aliases {};
+    bool changed = hosts_file_path != previous->hosts_file_path || aliases.size() != old_aliases.size();
+    auto old_iter = old_aliases.cbegin();
+    for( auto iter = aliases.cbegin(); iter != aliases.cend(); ++iter ){
+        while( old_iter != old_aliases.cend() && old_iter.key() < iter.key() ) ++old_iter;
+        AliasSnapshot::AliasPtr node {};
+        if( old_iter != old_aliases.cend() && old_iter.key() == iter.key() &&
+                ( *old_iter )->Revision() == iter->Revision() && ( *old_iter )->Address() == iter->Address() ){
+            node = *old_iter;
+        } else {
+            node = std::make_shared<Alias const>( *iter );
+            changed = true;
+        }
+        // keys arrive in order, the end is always the right place
+        new_aliases.insert( new_aliases.cend(), iter.key(), node );
+    }
+    if( !changed ) return previous;
+
+    AliasSnapshotPtr const next = std::make_shared<AliasSnapshot const>(
+                AliasSnapshot{ previous->version + 1, hosts_file_path, new_aliases } );
+    std::atomic_store( &current, next );
+    return next;
+}
@@ -0,0 +1,55 @@
+#ifndef ALIAS_SNAPSHOT_HPP
+#define ALIAS_SNAPSHOT_HPP
+
+#include <QMap>
+#include <QString>
+#include <memory>
+
+#include "alias.hpp"
+
+// One version of the aliases as the writer published it. Nothing in it changes once it is
+// published, so any thread may read it without a lock for as long as it holds on to it.
+// Aliases are shared between versions: one that didn't change is the same node in both.
+struct AliasSnapshot
+{
+    using AliasPtr = std::shared_ptr<Alias const>;
+
+    quint64                  version; // 1 for the first one published, then one up per change
+    QString                  hosts_file_path;
+    QMap<QString, AliasPtr>  aliases;
+};
+
+using AliasSnapshotPtr = std::shared_ptr<AliasSnapshot const>;
+
+// Hands AliasSnapshots from the single writer( the GUI thread, through AliasStore ) to any
+// number of readers. Taking the current one is std::atomic_load on the shared pointer and
+// publishing is std::atomic_store of a version built off to the side, so no call site takes
+// a mutex. That is not lock-free: libstdc++ guards both with a spinlock from a small global
+// pool, held only while the pointer and its count are copied. A reader still holding an old
+// version keeps it alive until it lets go.
+class AliasSnapshotPublisher
+{
+public:
+    AliasSnapshotPublisher();
+    // both carry over the source's current version, the source keeps it too. Assigning
+    // republishes it numbered past the target's own, so readers of a store replaced by a
+    // freshly loaded one never see the version go back
+    AliasSnapshotPublisher( AliasSnapshotPublisher && other );
+    AliasSnapshotPublisher & operator=( AliasSnapshotPublisher && other );
+
+    // any thread. Never null, an empty version 0 before anything was published
+    AliasSnapshotPtr Current() const;
+    // writer only. Aliases whose revision didn't move keep their node from the current
+    // version, only the changed ones are copied, but the map holding them is built anew,
+    // O(aliases) per call. Returns the version now current, which is the previous one when
+    // nothing changed
+    AliasSnapshotPtr Publish( QMap<QString, Alias> const & aliases, QString const & hosts_file_path );
+private:
+    AliasSnapshotPublisher( AliasSnapshotPublisher const & ) = delete;
+    AliasSnapshotPublisher & operator=( AliasSnapshotPublisher const & ) = delete;
+
+    // only ever touched through std::atomic_load/std::atomic_store
+    AliasSnapshotPtr current;
+};
+
+#endif // ALIAS_SNAPSHOT_HPP
@@ -0,0 +1,637 @@
+#include "alias_store.hpp"
+#include "config_journal.hpp"
+#include "config_snapshot.hpp"
+#include "json_stream_writer.hpp"
+#include "profile_cache.hpp"
+#include "statistics.hpp"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <algorithm>
+#include <limits>
+
+AliasStore::AliasStore(): hosts_file_path{}, hosts_file_targets{}, aliases{}, domain_owners{}, trie{}, profiles{},
+    active_profile{}, alias_name_index{}, alias_address_index{}, domain_index{}, search_alias_names{},
+    search_alias_ids{}, searchable_domains{}, search_domains_stale{ true },
+    search_addresses_stale{ false }, journaling{ false }, journal_records{}, journal_generation{ 0 }, journal_bytes{ 0 },
+    snapshots{}
+{
+}
+
+bool AliasStore::Load( QString const & config_path, QString & error, QStringList & warnings,
+                       SnapshotMode snapshot_mode )
+{
+    ScopedTimer const timer{ Statistics::ConfigLoad };
+    ConfigState snapshot {};
+    if( ConfigSnapshot::Read( config_path, snapshot ) ){
+        hosts_file_path = snapshot.hosts_file_path;
+        hosts_file_targets = snapshot.hosts_file_targets;
+        aliases.swap( snapshot.aliases );
+        domain_owners.clear();
+        for( auto const & alias: aliases ){
+            for( DomainId const id: alias.GetDomainNames() ) domain_owners.insert( id, alias.Name() );
+        }
+        IndexWildcards( snapshot.wildcard_hosts );
+        profiles.swap( snapshot.profiles );
+        active_profile.clear();
+    } else {
+        if( !LoadJson( config_path, error, warnings ) ) return false;
+        // the snapshot was missing or stale, the next start won't have to do all of this
+        if( snapshot_mode == SnapshotMode::Refresh ) ConfigSnapshot::Write( State( config_path ) );
+    }
+    // replayed changes are already in the journal, they must not be journaled again
+    bool const was_journaling = journaling;
+    journaling = false;
+    journal_generation = ConfigJournal::Replay( config_path, *this, warnings, journal_bytes );
+    journaling = was_journaling;
+    Statistics::Global().AddEntries( Statistics::ConfigLoad, domain_owners.size() );
+    search_domains_stale = search_addresses_stale = true;
+    Publish();
+    return true;
+}
+
+void AliasStore::IndexWildcards( QHash<QString, std::vector<DomainId>> const & wildcard_hosts )
+{
+    trie.Clear();
+    QSet<QByteArray> suffixes {};
+    for( auto const & alias: aliases ){
+        for( auto const & pattern: alias.Wildcards() ){
+            trie.SetRule( pattern, alias.Name() );
+            suffixes.insert( pattern.mid( 2 ).toLower().toUtf8() );
+        }
+    }
+    // without rules no host is looked at, however many there are
+    AddHostsUnder( suffixes );
+    for( auto const & hosts: wildcard_hosts ){
+        for( DomainId const id: hosts ) trie.AddHost( id );
+    }
+}
+
+void AliasStore::AddHostsUnder( QSet<QByteArray> const & suffixes )
+{
+    if( suffixes.isEmpty() ) return;
+    DomainPool const &pool = DomainPool::Global();
+    for( auto iter = domain_owners.cbegin(); iter != domain_owners.cend(); ++iter ){
+        QByteArray const name = pool.Utf8( iter.key() ).toLower();
+        // "a.b.staging.corp" tries "b.staging.corp", "staging.corp" and "corp"
+        for( int i = 0; i != name.size(); ++i ){
+            if( name[i] != '.' ) continue;
+            if( suffixes.contains( QByteArray::fromRawData( name.constData() + i + 1, name.size() - i - 1 ) ) ){
+                trie.AddHost( iter.key() );
+                break;
+            }
+        }
+    }
+}
+
+bool AliasStore::LoadJson( QString const & config_path, QString & error, QStringList & warnings )
+{
+    QFile config_file { config_path };
+    if( !config_file.open( QIODevice::ReadOnly ) ){
+        error = config_file.errorString();
+        return false;
+    }
+    QJsonObject doc_root {};
+    {
+        QByteArray const content = config_file.readAll();
+        config_file.close();
+        Statistics::Global().AddBytesRead( Statistics::ConfigLoad, content.size() );
+        Statistics::Global().AddBytesRead( Statistics::JsonParse, content.size() );
+
+        ScopedTimer const parse_timer{ Statistics::JsonParse };
+        QJsonDocument config_json_doc{ QJsonDocument::fromJson( content ) };
+        if( config_json_doc.isNull() ){
+            error = "The configuration file has been tampered with.\n"
+                    "Please remove it and restart the application.";
+            return false;
+        }
+        if( !config_json_doc.isObject() ){
+            error = "The root of the configuration must be an object {} file.";
+            return false;
+        }
+        doc_root = config_json_doc.object();
+    }
+    // if we are here, we have a valid document root
+    if( !doc_root.contains( "host" ) ){
+        error = "The location of the hosts file could not be obtained";
+        return false;
+    }
+    if( !doc_root.contains( "aliases" ) || !doc_root.value( "aliases" ).isArray() ){
+        error = "Unable to find ( a valid ) key 'aliases'";
+        return false;
+    }
+    hosts_file_path = doc_root.value( "host" ).toString();
+    hosts_file_targets.clear();
+    for( auto const & value: doc_root.value( "targets" ).toArray() ){
+        QString const target = value.toString().trimmed();
+        if( target.isEmpty() || target == hosts_file_path || hosts_file_targets.contains( target ) ){
+            warnings << QString( "Ignoring the empty or repeated hosts file target '%1'" ).arg( target );
+            continue;
+        }
+        hosts_file_targets.append( target );
+    }
+    aliases.clear();
+    domain_owners.clear();
+
+    QHash<QString, std::vector<DomainId>> wildcard_hosts {};
+    ReadAliases( doc_root.value( "aliases" ).toArray(), aliases, wildcard_hosts, domain_owners, warnings );
+
+    profiles.clear();
+    active_profile.clear();
+    for( auto const & value: doc_root.value( "profiles" ).toArray() ){
+        QJsonObject const json_profile = value.toObject();
+        QString const name = json_profile.value( "name" ).toString();
+        if( name.isEmpty() || profiles.contains( name ) ){
+            warnings << QString( "Ignoring the unnamed or repeated profile '%1'" ).arg( name );
+            continue;
+        }
+        Profile &profile = profiles[name];
+        QHash<DomainId, QString> owners {};
+        ReadAliases( json_profile.value( "aliases" ).toArray(), profile.aliases, profile.wildcard_hosts,
+                     owners, warnings );
+        profile.fingerprint = ProfileCache::Fingerprint( profile );
+    }
+    IndexWildcards( wildcard_hosts );
+    return true;
+}
+
+void AliasStore::ReadAliases( QJsonArray const & json_aliases, QMap<QString, Alias> & aliases,
+                              QHash<QString, std::vector<DomainId>> & wildcard_hosts,
+                              QHash<DomainId, QString> & owners, QStringList & warnings )
+{
+    DomainPool &pool = DomainPool::Global();
+    for( auto const &alias : json_aliases ){
+        if( !alias.isObject() ){
+            warnings << "Invalid alias found";
+            continue;
+        }
+        QJsonObject current_alias = alias.toObject();
+        QString const name = current_alias.value( "name" ).toString(), ip = current_alias.value( "ip" ).toString();
+        IpAddress address {};
+        bool const parsed = IpAddress::Parse( ip, address );
+        if( !parsed ){
+            // kept with its domains as written, the user has to give it an address we can use
+            warnings << QString( "The alias '%1' has an IP address '%2' that can't be used, it is left out of "
+                                 "the hosts file until it is changed." ).arg( name, ip );
+        }
+        Alias value_alias = parsed ? Alias{ name, address } : Alias::Unparsed( name, ip );
+        if( aliases.contains( value_alias.Name() ) ){
+            warnings << QString( "In the aliases, '%1' already exist." ).arg( value_alias.Name() );
+            continue;
+        }
+        QJsonArray pointing_to_domains = current_alias.value( "pointing_to" ).toArray();
+
+        for( auto const & domain: pointing_to_domains ) {
+            DomainId const id = pool.Intern( domain.toString() );
+            if( owners.contains( id ) ){
+                qDebug() << "Duplicate domain name found:" << domain.toString() << ", ignoring.";
+                continue;
+            }
+            value_alias.InsertDomain( id );
+            owners.insert( id, value_alias.Name() );
+        }
+        for( auto const & wildcard: current_alias.value( "wildcards" ).toArray() ){
+            QJsonObject const rule = wildcard.toObject();
+            QString const pattern = rule.value( "rule" ).toString();
+            if( !DomainTrie::IsWildcard( pattern ) || wildcard_hosts.contains( pattern ) ){
+                warnings << QString( "Ignoring the invalid or repeated rule '%1'" ).arg( pattern );
+                continue;
+            }
+            std::vector<DomainId> &hosts = wildcard_hosts[pattern];
+            for( auto const & host: rule.value( "hosts" ).toArray() ) hosts.push_back( pool.Intern( host.toString() ) );
+            value_alias.InsertWildcard( pattern );
+        }
+        aliases.insert( value_alias.Name(), value_alias );
+    }
+}
+
+bool AliasStore::ImportHostsFile( QString const & hosts_path, QString const & config_path, QString & error )
+{
+    HostsMapping mapping {};
+    if( !HostsParser::ParseFile( hosts_path, mapping ) ){
+        error = QString( "Unable to read the hosts file '%1'" ).arg( hosts_path );
+        return false;
+    }
+    return WriteConfigFromMapping( config_path, hosts_path, mapping, error );
+}
+
+bool AliasStore::WriteConfigFromMapping( QString const & config_path, QString const & hosts_path,
+                                         HostsMapping const & mapping, QString & error )
+{
+    QSaveFile config_file( config_path );
+    if( !config_file.open( QIODevice::WriteOnly ) ){
+        error = config_file.errorString();
+        return false;
+    }
+    JsonStreamWriter json{ config_file };
+    json.BeginObject();
+    json.Key( "aliases" );
+    json.BeginArray();
+    unsigned int i = 0;
+    for( auto iter = mapping.cbegin(); iter != mapping.cend(); ++iter ){
+        json.BeginObject();
+        json.Key( "ip" );
+        json.Value( iter.key().ToString() );
+        json.Key( "name" );
+        json.Value( QString( "untitled_%1" ).arg( i ) );
+        json.Key( "pointing_to" );
+        json.BeginArray();
+        for( auto const & value : iter.value() ) json.Value( value );
+        json.EndArray();
+        json.EndObject();
+        ++i;
+    }
+    json.EndArray();
+    json.Key( "host" );
+    json.Value( hosts_path );
+    json.EndObject();
+    if( !json.Finish() ){
+        error = config_file.errorString();
+        return false;
+    }
+    if( !config_file.commit() ){
+        error = config_file.errorString();
+        return false;
+    }
+    // whatever was journaled against the config this one replaces doesn't apply to it
+    ConfigJournal::Discard( config_path, std::numeric_limits<quint64>::max() );
+    return true;
+}
+
+QString const & AliasStore::HostsFilePath() const { return hosts_file_path; }
+QStringList const & AliasStore::HostsFileTargets() const { return hosts_file_targets; }
+QMap<QString, Alias> const & AliasStore::Aliases() const { return aliases; }
+QHash<DomainId, QString> const & AliasStore::DomainOwners() const { return domain_owners; }
+AliasSnapshotPtr AliasStore::Snapshot() const { return snapshots.Current(); }
+
+AliasSnapshotPtr AliasStore::Publish()
+{
+    return snapshots.Publish( aliases, hosts_file_path );
+}
+
+bool AliasStore::HasDomain( QString const & domain_name ) const
+{
+    DomainId id {};
+    return DomainPool::Global().Find( domain_name, id ) && domain_owners.contains( id );
+}
+
+bool AliasStore::AddAlias( QString const & name, IpAddress const & address )
+{
+    if( aliases.contains( name ) ) return false;
+    aliases.insert( name, Alias{ name, address } );
+    if( journaling ) journal_records.append( ConfigJournal::AddAliasRecord( name, address ) );
+    return true;
+}
+
+bool AliasStore::SetAliasAddress( QString const & name, IpAddress const & address )
+{
+    auto alias = aliases.find( name );
+    if( alias == aliases.end() ) return false;
+    alias->SetAddress( address );
+    search_addresses_stale = true;
+    active_profile.clear();
+    if( journaling ) journal_records.append( ConfigJournal::SetAddressRecord( name, address ) );
+    return true;
+}
+
+bool AliasStore::PointDomainTo( QString const & domain_name, QString const & alias_name )
+{
+    auto target = aliases.find( alias_name );
+    if( target == aliases.end() ) return false;
+    if( journaling ) journal_records.append( ConfigJournal::PointDomainRecord( domain_name, alias_name ) );
+
+    DomainId const id = DomainPool::Global().Intern( domain_name );
+    if( trie.Covers( domain_name ) ) trie.AddHost( id );
+    auto owner = domain_owners.find( id );
+    if( owner != domain_owners.end() ){
+        if( owner.value() == alias_name ) return true;
+        auto previous = aliases.find( owner.value() );
+        if( previous != aliases.end() ) previous->RemoveDomain( id );
+        owner.value() = alias_name;
+    } else {
+        domain_owners.insert( id, alias_name );
+        search_domains_stale = true;
+    }
+    target->InsertDomain( id );
+    active_profile.clear();
+    return true;
+}
+
+int AliasStore::PointDomainsTo( QVector<DomainMove> const & moves )
+{
+    DomainPool &pool = DomainPool::Global();
+    int applied = 0;
+    for( auto const & move: moves ){
+        if( DomainTrie::IsWildcard( move.first ) ){
+            if( ApplyWildcard( move.first, move.second ) ) ++applied;
+            continue;
+        }
+        if( !aliases.contains( move.second ) ) continue;
+        DomainId const id = pool.Intern( move.first );
+        domain_owners.insert( id, move.second );
+        if( trie.Covers( move.first ) ) trie.AddHost( id );
+        ++applied;
+    }
+    if( applied != 0 ){
+        // moves to unknown aliases are skipped on replay just as they were here
+        if( journaling ) journal_records.append( ConfigJournal::PointDomainsRecord( moves ) );
+        RebuildDomainLists();
+    }
+    return applied;
+}
+
+bool AliasStore::PointSubtreeTo( QString const & pattern, QString const & alias_name )
+{
+    if( !ApplyWildcard( pattern, alias_name ) ) return false;
+    if( journaling ) journal_records.append( ConfigJournal::PointSubtreeRecord( pattern, alias_name ) );
+    RebuildDomainLists();
+    return true;
+}
+
+bool AliasStore::ApplyWildcard( QString const & pattern, QString const & alias_name )
+{
+    auto target = aliases.find( alias_name );
+    if( !DomainTrie::IsWildcard( pattern ) || target == aliases.end() ) return false;
+
+    for( auto & alias: aliases ) alias.RemoveWildcard( pattern );
+    target->InsertWildcard( pattern );
+    trie.SetRule( pattern, alias_name );
+    // hosts pointed one by one only join the trie once a rule covers them
+    AddHostsUnder( QSet<QByteArray>{ pattern.mid( 2 ).toLower().toUtf8() } );
+    for( DomainId const id: trie.Expand( pattern ) ) domain_owners.remove( id );
+    return true;
+}
+
+QString AliasStore::RuleOwner( QString const & domain_name ) const
+{
+    return trie.Match( domain_name );
+}
+
+QHash<DomainId, QString> AliasStore::RuleHosts() const
+{
+    QVector<QPair<QString, QString>> rules {}; // pattern, alias name
+    for( auto const & alias: aliases ){
+        for( auto const & pattern: alias.Wildcards() ) rules.append( qMakePair( pattern, alias.Name() ) );
+    }
+    // a host below nested rules belongs to the most specific one, so those go last and win
+    std::stable_sort( rules.begin(), rules.end(), []( QPair<QString, QString> const & a, QPair<QString, QString> const & b ){
+        return a.first.count( '.' ) < b.first.count( '.' );
+    });
+    QHash<QString, std::vector<DomainId>> const wildcard_hosts = WildcardHosts();
+    QHash<DomainId, QString> hosts {};
+    for( auto const & rule: rules ){
+        QString const owner = rule.second + " (" + rule.first + ")";
+        for( DomainId const id: wildcard_hosts.value( rule.first ) ) hosts.insert( id, owner );
+    }
+    return hosts;
+}
+
+QStringList AliasStore::SearchAliases( QString const & prefix, int limit ) const
+{
+    // a popular prefix can match a million domains owned by a handful of aliases
+    static int const s_max_domain_visits = 4096;
+
+    QStringList found {};
+    if( limit <= 0 ) return found;
+    UpdateSearchIndex( !prefix.isEmpty() );
+
+    QSet<QString> seen {};
+    auto take = [&]( QString const & alias_name ){
+        if( aliases.contains( alias_name ) && !seen.contains( alias_name ) ){
+            seen.insert( alias_name );
+            found.append( alias_name );
+        }
+        return found.size() < limit;
+    };
+    auto take_alias = [&]( quint32 id ){ return take( search_alias_names[id] ); };
+    alias_name_index.Find( prefix, take_alias );
+    if( found.size() < limit ) alias_address_index.Find( prefix, take_alias );
+    // with nothing typed every alias is a match already
+    if( found.size() < limit && !prefix.isEmpty() ){
+        int visits = 0;
+        domain_index.Find( prefix, [&]( quint32 id ){
+            auto const owner = domain_owners.constFind( id );
+            if( owner != domain_owners.cend() && !take( owner.value() ) ) return false;
+            return ++visits < s_max_domain_visits;
+        });
+    }
+    return found;
+}
+
+void AliasStore::UpdateSearchIndex( bool with_domains ) const
+{
+    if( search_alias_names.size() != aliases.size() ){
+        for( auto const & alias: aliases ){
+            if( search_alias_ids.contains( alias.Name() ) ) continue;
+            quint32 const id = static_cast<quint32>( search_alias_names.size() );
+            search_alias_names.append( alias.Name() );
+            search_alias_ids.insert( alias.Name(), id );
+            alias_name_index.Add( alias.Name(), id );
+            if( !search_addresses_stale ) alias_address_index.Add( alias.AddressText(), id );
+        }
+    }
+    if( search_addresses_stale ){
+        alias_address_index.Clear();
+        for( int id = 0; id != search_alias_names.size(); ++id ){
+            auto const alias = aliases.constFind( search_alias_names[id] );
+            if( alias != aliases.cend() ) alias_address_index.Add( alias->AddressText(), static_cast<quint32>( id ) );
+        }
+        search_addresses_stale = false;
+    }
+    if( !with_domains || !search_domains_stale ) return;
+    // the pool also holds every name ever imported or read from a hosts file; only a
+    // pointed one can lead to an alias
+    DomainPool const &pool = DomainPool::Global();
+    searchable_domains.resize( static_cast<std::size_t>( pool.Size() ), false );
+    for( auto iter = domain_owners.cbegin(); iter != domain_owners.cend(); ++iter ){
+        DomainId const id = iter.key();
+        if( searchable_domains[id] ) continue;
+        searchable_domains[id] = true;
+        QByteArray const name = pool.Utf8( id );
+        domain_index.Add( name.constData(), name.size(), id );
+    }
+    search_domains_stale = false;
+}
+
+int AliasStore::MergeHostsEntries( HostsMapping const & added, HostsMapping const & removed )
+{
+    DomainPool &pool = DomainPool::Global();
+    int changed = 0;
+    for( auto iter = removed.cbegin(); iter != removed.cend(); ++iter ){
+        for( auto const & domain: iter.value() ){
+            DomainId id {};
+            if( !pool.Find( domain, id ) ) continue;
+            auto owner = domain_owners.find( id );
+            if( owner == domain_owners.end() ){
+                // a host a rule owned is no longer known
+                QString const rule_owner = trie.Match( domain );
+                auto alias = aliases.constFind( rule_owner );
+                if( alias != aliases.cend() && alias->Address() == iter.key() && trie.HasHost( id ) ){
+                    trie.RemoveHost( id );
+                    ++changed;
+                }
+                continue;
+            }
+            // the line is gone, but we may have pointed the domain somewhere else since
+            auto alias = aliases.constFind( owner.value() );
+            if( alias != aliases.cend() && alias->Address() != iter.key() ) continue;
+            domain_owners.erase( owner );
+            trie.RemoveHost( id );
+            ++changed;
+        }
+    }
+
+    QHash<IpAddress, QString> alias_by_address {};
+    for( auto const & alias: aliases ){
+        if( alias.HasAddress() && !alias_by_address.contains( alias.Address() ) ){
+            alias_by_address.insert( alias.Address(), alias.Name() );
+        }
+    }
+    int next_untitled = 0;
+    for( auto iter = added.cbegin(); iter != added.cend(); ++iter ){
+        auto target = alias_by_address.find( iter.key() );
+        if( target == alias_by_address.end() ){
+            QString name {};
+            do name = QString( "untitled_%1" ).arg( next_untitled++ ); while( aliases.contains( name ) );
+            aliases.insert( name, Alias{ name, iter.key() } );
+            target = alias_by_address.insert( iter.key(), name );
+        }
+        for( auto const & domain: iter.value() ){
+            DomainId const id = pool.Intern( domain );
+            bool const covered = trie.Covers( domain ), known_host = covered && trie.HasHost( id );
+            if( covered ) trie.AddHost( id );
+            auto owner = domain_owners.find( id );
+            if( owner == domain_owners.end() ){
+                auto rule_alias = aliases.constFind( trie.Match( domain ) );
+                if( rule_alias == aliases.cend() || rule_alias->Address() != iter.key() ){
+                    domain_owners.insert( id, target.value() );
+                } else if( known_host ){
+                    // the rule says so already, as when the watcher hands back our own write
+                    continue;
+                }
+                // otherwise already where its rule points, just a newly known host
+            } else {
+                auto alias = aliases.constFind( owner.value() );
+                if( alias != aliases.cend() && alias->Address() == iter.key() ) continue;
+                owner.value() = target.value();
+            }
+            ++changed;
+        }
+    }
+    // one rebuild instead of a sorted insert per line, blocklists come in by the thousand
+    if( changed != 0 ){
+        if( journaling ) journal_records.append( ConfigJournal::MergeEntriesRecord( added, removed ) );
+        RebuildDomainLists();
+    }
+    return changed;
+}
+
+void AliasStore::RebuildDomainLists()
+{
+    // every caller changed something, the aliases no longer match a saved profile
+    active_profile.clear();
+    search_domains_stale = true;
+    QHash<QString, std::vector<DomainId>> domain_lists {};
+    for( auto iter = domain_owners.cbegin(); iter != domain_owners.cend(); ++iter ){
+        domain_lists[iter.value()].push_back( iter.key() );
+    }
+    for( auto iter = aliases.begin(); iter != aliases.end(); ++iter ){
+        iter->SetDomains( std::move( domain_lists[iter.key()] ) );
+    }
+}
+
+QHash<QString, std::vector<DomainId>> AliasStore::WildcardHosts() const
+{
+    QHash<QString, std::vector<DomainId>> wildcard_hosts {};
+    for( auto const & alias: aliases ){
+        for( auto const & pattern: alias.Wildcards() ){
+            std::vector<DomainId> &hosts = wildcard_hosts[pattern];
+            for( DomainId const id: trie.Expand( pattern ) ){
+                if( !domain_owners.contains( id ) ) hosts.push_back( id );
+            }
+            std::sort( hosts.begin(), hosts.end() );
+        }
+    }
+    return wildcard_hosts;
+}
+
+QStringList AliasStore::ProfileNames() const { return profiles.keys(); }
+QString const & AliasStore::ActiveProfile() const { return active_profile; }
+
+void AliasStore::SaveProfile( QString const & name )
+{
+    Profile &profile = profiles[name];
+    profile.aliases = aliases;
+    profile.wildcard_hosts = WildcardHosts();
+    profile.fingerprint = ProfileCache::Fingerprint( profile );
+    active_profile = name;
+    if( journaling ) journal_records.append( ConfigJournal::SaveProfileRecord( name, profile ) );
+}
+
+void AliasStore::RestoreProfile( QString const & name, Profile const & profile )
+{
+    Profile &restored = profiles[name];
+    restored = profile;
+    restored.fingerprint = ProfileCache::Fingerprint( restored );
+    Profile const current{ aliases, WildcardHosts(), 0 };
+    if( ProfileCache::Fingerprint( current ) == restored.fingerprint ) active_profile = name;
+    else if( active_profile == name ) active_profile.clear();
+    if( journaling ) journal_records.append( ConfigJournal::SaveProfileRecord( name, restored ) );
+}
+
+bool AliasStore::SwitchToProfile( QString const & name )
+{
+    auto const profile = profiles.constFind( name );
+    if( profile == profiles.cend() ) return false;
+
+    for( auto iter = aliases.begin(); iter != aliases.end(); ++iter ){
+        auto const saved = profile->aliases.constFind( iter.key() );
+        if( saved != profile->aliases.cend() ){
+            *iter = saved.value();
+        } else {
+            *iter = iter->HasAddress() ? Alias{ iter->Name(), iter->Address() }
+                                       : Alias::Unparsed( iter->Name(), iter->UnparsedAddress() );
+        }
+    }
+    // aliases removed since the profile was saved come back with it
+    for( auto iter = profile->aliases.cbegin(); iter != profile->aliases.cend(); ++iter ){
+        if( !aliases.contains( iter.key() ) ) aliases.insert( iter.key(), iter.value() );
+    }
+    domain_owners.clear();
+    for( auto const & alias: aliases ){
+        for( DomainId const id: alias.GetDomainNames() ) domain_owners.insert( id, alias.Name() );
+    }
+    IndexWildcards( profile->wildcard_hosts );
+    // the profile's aliases may point elsewhere than the ones they replaced
+    search_domains_stale = search_addresses_stale = true;
+    active_profile = name;
+    if( journaling ) journal_records.append( ConfigJournal::SwitchProfileRecord( name ) );
+    return true;
+}
+
+ConfigState AliasStore::State( QString const & config_path ) const
+{
+    return ConfigState{ config_path, hosts_file_path, aliases, WildcardHosts(), profiles, active_profile,
+                        journal_generation, hosts_file_targets };
+}
+
+void AliasStore::SetJournaling( bool enabled )
+{
+    journaling = enabled;
+    if( !enabled ) journal_records.clear();
+}
+
+QVector<QByteArray> AliasStore::TakeJournalRecords()
+{
+    QVector<QByteArray> records {};
+    records.swap( journal_records );
+    return records;
+}
+
+quint64 AliasStore::JournalGeneration() const { return journal_generation; }
+qint64 AliasStore::JournalBytes() const { return journal_bytes; }
@@ -0,0 +1,158 @@
+#ifndef ALIAS_STORE_HPP
+#define ALIAS_STORE_HPP
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonArray>
+#include <QMap>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "alias.hpp"
+#include "alias_snapshot.hpp"
+#include "config_writer.hpp"
+#include "domain_trie.hpp"
+#include "hosts_parser.hpp"
+#include "search_index.hpp"
+
+// The aliases, the domain -> alias index and the hosts file location, with no
+// GUI attached, so the tray application and the headless batch mode share one model.
+// The store itself belongs to one thread, the writer; other threads and anything that
+// outlives a change read the immutable versions it publishes, see Snapshot().
+class AliasStore
+{
+public:
+    using DomainMove = QPair<QString, QString>; // domain name, alias name
+
+    // whether a Load that had to read config.json writes a fresh snapshot for the next one
+    enum class SnapshotMode { Refresh, ReadOnly };
+
+    AliasStore();
+
+    // reads the binary snapshot when it is current and config.json otherwise, then replays
+    // the journal on top of it. Problems that only cost a single entry are added to
+    // `warnings`, a failed load sets `error`
+    bool Load( QString const & config_path, QString & error, QStringList & warnings,
+               SnapshotMode snapshot_mode = SnapshotMode::Refresh );
+
+    // first run: every address found in the hosts file becomes an "untitled_N" alias
+    // of a brand new config.json
+    static bool ImportHostsFile( QString const & hosts_path, QString const & config_path, QString & error );
+    static bool WriteConfigFromMapping( QString const & config_path, QString const & hosts_path,
+                                        HostsMapping const & mapping, QString & error );
+
+    QString const &                  HostsFilePath() const;
+    // config.json's "targets": more hosts files written with the same image
+    QStringList const &              HostsFileTargets() const;
+    QMap<QString, Alias> const &     Aliases() const;
+    QHash<DomainId, QString> const & DomainOwners() const;
+    bool                             HasDomain( QString const & domain_name ) const;
+
+    // returns false if an alias of that name exists
+    bool AddAlias( QString const & name, IpAddress const & address );
+    // gives an alias a new address, which is how one read with an unusable address is fixed.
+    // Returns false if there is no such alias
+    bool SetAliasAddress( QString const & name, IpAddress const & address );
+
+    // moves `domain_name` to `alias_name`, taking it away from whichever alias owned it.
+    // Returns false if there is no such alias
+    bool PointDomainTo( QString const & domain_name, QString const & alias_name );
+    // the same for many domains at once: only the index is touched per move and every
+    // alias' domain list is rebuilt once at the end. Returns how many moves were applied,
+    // moves to unknown aliases are skipped
+    int  PointDomainsTo( QVector<DomainMove> const & moves );
+    // hands the whole subtree of a "*.staging.corp" rule to `alias_name`: the rule moves
+    // and every host below it that was pointed one by one follows it. Moves within
+    // PointDomainsTo may be rules too. Returns false for an unknown alias or a bad pattern
+    bool PointSubtreeTo( QString const & pattern, QString const & alias_name );
+    // the alias of the most specific rule covering `domain_name`, empty when none does
+    QString RuleOwner( QString const & domain_name ) const;
+    // every known host only a rule points -> "alias (*.rule)", for listing them next to
+    // DomainOwners()
+    QHash<DomainId, QString> RuleHosts() const;
+    // type-ahead for the alias pickers: aliases whose name starts with `prefix`, then those
+    // whose address does, then the owners of domains that do. Case insensitive, no repeats,
+    // at most `limit` names
+    QStringList SearchAliases( QString const & prefix, int limit ) const;
+
+    QStringList     ProfileNames() const;
+    // empty once anything was changed after saving or switching to a profile
+    QString const & ActiveProfile() const;
+    // the current domains and rules become profile `name`, replacing one of the same name
+    void SaveProfile( QString const & name );
+    // journal replay: profile `name` becomes exactly `profile`. It is the active one only
+    // when the aliases still are what it holds
+    void RestoreProfile( QString const & name, Profile const & profile );
+    // every alias takes its domains and rules from the profile, aliases the profile doesn't
+    // know are left empty. Returns false if there is no such profile
+    bool SwitchToProfile( QString const & name );
+    // makes the model agree with lines another program added to or removed from the hosts
+    // file. Addresses without an alias get a new "untitled_N" one. Returns how many
+    // domains changed
+    int  MergeHostsEntries( HostsMapping const & added, HostsMapping const & removed );
+
+    ConfigState State( QString const & config_path ) const;
+
+    // the latest published version of the aliases, safe to hand to any thread
+    AliasSnapshotPtr Snapshot() const;
+    // makes the changes so far visible to Snapshot() readers. Load publishes by itself,
+    // after that the writer decides when a batch of changes is complete
+    AliasSnapshotPtr Publish();
+
+    // while on, every change also leaves a ConfigJournal record behind, for the caller to
+    // append instead of rewriting config.json
+    void                SetJournaling( bool enabled );
+    QVector<QByteArray> TakeJournalRecords();
+    // the newest journal generation Load replayed, 0 if there was none, and the bytes
+    // of journal it read
+    quint64             JournalGeneration() const;
+    qint64              JournalBytes() const;
+private:
+    bool LoadJson( QString const & config_path, QString & error, QStringList & warnings );
+    // `owners` both catches domains listed twice and receives domain -> alias
+    static void ReadAliases( QJsonArray const & json_aliases, QMap<QString, Alias> & aliases,
+                             QHash<QString, std::vector<DomainId>> & wildcard_hosts,
+                             QHash<DomainId, QString> & owners, QStringList & warnings );
+    QHash<QString, std::vector<DomainId>> WildcardHosts() const;
+    void RebuildDomainLists();
+    // index only, the caller rebuilds the alias lists
+    bool ApplyWildcard( QString const & pattern, QString const & alias_name );
+    void IndexWildcards( QHash<QString, std::vector<DomainId>> const & wildcard_hosts );
+    // puts the hosts of domain_owners below any of `suffixes`( "staging.corp", lowercased )
+    // into the trie
+    void AddHostsUnder( QSet<QByteArray> const & suffixes );
+    // adds the aliases that appeared since the last search and redoes the addresses if one
+    // changed. Domains are only caught up on when `with_domains`, typing nothing never needs them
+    void UpdateSearchIndex( bool with_domains ) const;
+
+    QString                   hosts_file_path;
+    QStringList               hosts_file_targets;
+    QMap<QString, Alias>      aliases;
+    QHash<DomainId, QString>  domain_owners; // domain -> name of the alias pointing to it
+    // every known host plus the wildcard rules. Hosts a rule owns have no entry in
+    // domain_owners, a domain pointed one by one always wins over a rule
+    DomainTrie                trie;
+    QMap<QString, Profile>    profiles;
+    QString                   active_profile;
+    // search caches. Names and domains are only ever added to, aliases aren't removed and a
+    // domain that was pointed once stays findable; stale hits are filtered per query. The
+    // addresses are redone whenever one moves, there is one per alias
+    mutable SearchIndex       alias_name_index;
+    mutable SearchIndex       alias_address_index;
+    mutable SearchIndex       domain_index; // pointed domains only, not everything the pool holds
+    mutable QVector<QString>  search_alias_names; // search id -> alias name
+    mutable QHash<QString, quint32> search_alias_ids;
+    mutable std::vector<bool> searchable_domains; // by DomainId, whether it is in domain_index
+    mutable bool              search_domains_stale;   // domain_owners gained entries since
+    mutable bool              search_addresses_stale; // an alias changed its address since
+    bool                      journaling;
+    QVector<QByteArray>       journal_records;
+    quint64                   journal_generation;
+    qint64                    journal_bytes;
+    AliasSnapshotPublisher    snapshots;
+};
+
+#endif // ALIAS_STORE_HPP
@@ -0,0 +1,193 @@
+#include "batch_runner.hpp"
+#include "blocklist_importer.hpp"
+#include "config_writer.hpp"
+#include "dns_responder.hpp"
+#include "dns_table.hpp"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <cstring>
+
+bool BatchRunner::IsRequested( int argc, char *argv[] )
+{
+    for( int i = 1; i < argc; ++i ){
+        if( std::strcmp( argv[i], "--batch" ) == 0 || std::strcmp( argv[i], "--import" ) == 0 ||
+                std::strcmp( argv[i], "--serve-dns" ) == 0 ){
+            return true;
+        }
+    }
+    return false;
+}
+
+int BatchRunner::Run( QStringList const & arguments )
+{
+    QTextStream out{ stdout }, err{ stderr };
+
+    QString batch_filename {}, config_path = "./config.json", upstream {};
+    QStringList import_lists {};
+    bool serve_dns = false;
+    quint16 dns_port = DnsResponder::s_default_port;
+    for( int i = 1; i < arguments.size(); ++i ){
+        if( arguments[i] == "--batch" && i + 1 < arguments.size() ) batch_filename = arguments[++i];
+        else if( arguments[i] == "--config" && i + 1 < arguments.size() ) config_path = arguments[++i];
+        else if( arguments[i] == "--serve-dns" ) serve_dns = true;
+        else if( arguments[i] == "--port" && i + 1 < arguments.size() ) dns_port = arguments[++i].toUShort();
+        else if( arguments[i] == "--upstream" && i + 1 < arguments.size() ) upstream = arguments[++i];
+        else if( arguments[i] == "--import" ){
+            while( i + 1 < arguments.size() && !arguments[i + 1].startsWith( "--" ) ) import_lists.append( arguments[++i] );
+        }
+    }
+    if( serve_dns ) return ServeDns( dns_port, upstream, config_path );
+    if( !import_lists.isEmpty() ) return RunImport( import_lists, config_path );
+    if( batch_filename.isEmpty() ){
+        err << "usage: " << arguments.value( 0 ) << " --batch <operations file> [--config <config.json>]\n"
+            << "       " << arguments.value( 0 ) << " --import <list> [<list>...] [--config <config.json>]\n"
+            << "       " << arguments.value( 0 ) << " --serve-dns [--port <port>] [--upstream <address[:port]>]"
+               " [--config <config.json>]\n";
+        return 2;
+    }
+
+    QElapsedTimer timer {};
+    timer.start();
+
+    AliasStore store {};
+    QString error {};
+    QStringList warnings {};
+    if( !store.Load( config_path, error, warnings ) ){
+        err << config_path << ": " << error << "\n";
+        return 1;
+    }
+    for( auto const & warning: warnings ) err << config_path << ": " << warning << "\n";
+    qint64 const load_ms = timer.restart();
+
+    QVector<AliasStore::DomainMove> moves {};
+    int malformed_lines = 0;
+    if( !ReadOperations( batch_filename, moves, malformed_lines, error ) ){
+        err << batch_filename << ": " << error << "\n";
+        return 1;
+    }
+    int const applied = store.PointDomainsTo( moves );
+    qint64 const apply_ms = timer.restart();
+
+    ConfigState const state = store.State( config_path );
+    if( !ConfigWriter::WriteConfigFile( state, error ) || !ConfigWriter::WriteHostsFile( state, error ) ){
+        err << "unable to write: " << error << "\n";
+        return 1;
+    }
+    qint64 const write_ms = timer.elapsed();
+
+    out << "applied " << applied << " of " << moves.size() << " operations";
+    if( malformed_lines ) out << ", " << malformed_lines << " malformed lines skipped";
+    if( applied != moves.size() ) out << ", " << moves.size() - applied << " named unknown aliases";
+    out << "\nload " << load_ms << " ms, apply " << apply_ms << " ms, write " << write_ms << " ms\n";
+    return applied == moves.size() && malformed_lines == 0 ? 0 : 3;
+}
+
+int BatchRunner::RunImport( QStringList const & lists, QString const & config_path )
+{
+    QTextStream out{ stdout }, err{ stderr };
+    QElapsedTimer timer {};
+    timer.start();
+
+    AliasStore store {};
+    QString error {};
+    QStringList warnings {};
+    if( !store.Load( config_path, error, warnings ) ){
+        err << config_path << ": " << error << "\n";
+        return 1;
+    }
+    for( auto const & warning: warnings ) err << config_path << ": " << warning << "\n";
+    qint64 const load_ms = timer.restart();
+
+    BlocklistImporter importer {};
+    bool all_readable = true;
+    for( auto const & list: lists ){
+        BlocklistImporter::SourceStats const stats = importer.AddFile( list );
+        if( !stats.readable ){
+            err << list << ": unable to open\n";
+            all_readable = false;
+            continue;
+        }
+        out << list << ": " << stats.entries << " entries, " << stats.unique << " unique, "
+            << stats.duplicates << " duplicates, " << stats.conflicts << " conflicting";
+        if( stats.invalid_lines ) out << ", " << stats.invalid_lines << " lines without an address";
+        out << "\n";
+    }
+    // what the config already points or covers stays where the user put it
+    qint64 const already_owned = importer.DropOwned( *store.Snapshot() );
+    qint64 const import_ms = timer.restart();
+    int const changed = store.MergeHostsEntries( importer.Mapping(), HostsMapping{} );
+    qint64 const apply_ms = timer.restart();
+
+    ConfigState const state = store.State( config_path );
+    if( !ConfigWriter::WriteConfigFile( state, error ) || !ConfigWriter::WriteHostsFile( state, error ) ){
+        err << "unable to write: " << error << "\n";
+        return 1;
+    }
+    qint64 const write_ms = timer.elapsed();
+
+    out << importer.UniqueCount() << " unique hosts, " << already_owned << " already in the config, "
+        << changed << " domains added\n"
+        << "load " << load_ms << " ms, import " << import_ms << " ms, apply " << apply_ms
+        << " ms, write " << write_ms << " ms\n";
+    return all_readable ? 0 : 3;
+}
+
+int BatchRunner::ServeDns( quint16 port, QString const & upstream, QString const & config_path )
+{
+    QTextStream out{ stdout }, err{ stderr };
+    AliasStore store {};
+    QString error {};
+    QStringList warnings {};
+    if( !store.Load( config_path, error, warnings ) ){
+        err << config_path << ": " << error << "\n";
+        return 1;
+    }
+    for( auto const & warning: warnings ) err << config_path << ": " << warning << "\n";
+
+    DnsTable table {};
+    table.Sync( store.Snapshot() );
+    DnsResponder responder{ table };
+    if( !responder.Start( port, upstream, error ) ){
+        err << "unable to listen on 127.0.0.1:" << port << ": " << error << "\n";
+        return 1;
+    }
+    out << "answering for " << table.Size() << " names and rules on 127.0.0.1:" << responder.Port();
+    if( !upstream.isEmpty() ) out << ", relaying the rest to " << upstream;
+    out << "\n";
+    out.flush();
+    return QCoreApplication::exec();
+}
+
+bool BatchRunner::ReadOperations( QString const & filename, QVector<AliasStore::DomainMove> & moves,
+                                  int & malformed_lines, QString & error )
+{
+    QFile file{ filename };
+    if( !file.open( QIODevice::ReadOnly ) ){
+        error = file.errorString();
+        return false;
+    }
+    QByteArray const content = file.readAll();
+    file.close();
+
+    int begin = 0;
+    while( begin < content.size() ){
+        int end = content.indexOf( '\n', begin );
+        if( end < 0 ) end = content.size();
+        QByteArray const line = QByteArray::fromRawData( content.constData() + begin, end - begin ).trimmed();
+        begin = end + 1;
+        if( line.isEmpty() || line.startsWith( '#' ) ) continue;
+
+        int const arrow = line.indexOf( "->" );
+        QByteArray const domain = arrow < 0 ? QByteArray{} : line.left( arrow ).trimmed();
+        QByteArray const alias = arrow < 0 ? QByteArray{} : line.mid( arrow + 2 ).trimmed();
+        if( domain.isEmpty() || alias.isEmpty() ){
+            ++malformed_lines;
+            continue;
+        }
+        moves.append( AliasStore::DomainMove( QString::fromUtf8( domain ), QString::fromUtf8( alias ) ) );
+    }
+    return true;
+}
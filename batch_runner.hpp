@@ -0,0 +1,31 @@
+#ifndef BATCH_RUNNER_HPP
+#define BATCH_RUNNER_HPP
+
+#include <QStringList>
+#include "alias_store.hpp"
+
+// Headless mode for scripts:
+//
+//   HostsFileManager --batch <operations file> [--config <path to config.json>]
+//   HostsFileManager --import <list> [<list>...] [--config <path to config.json>]
+//   HostsFileManager --serve-dns [--port <port>] [--upstream <address[:port]>] [--config <path to config.json>]
+//
+// Every non-empty, non '#' line of the operations file reads `domain -> alias`. All of
+// them are applied in memory and config.json and the hosts file are written once at the end.
+// --import merges hosts-format blocklists, duplicates dropped, into the config the same way
+// and prints how many entries of each list were new, repeated or conflicting.
+// --serve-dns answers DNS queries on 127.0.0.1 from the config as loaded, until killed.
+class BatchRunner
+{
+public:
+    static bool IsRequested( int argc, char *argv[] );
+    // returns the process' exit code
+    static int  Run( QStringList const & arguments );
+private:
+    static int  RunImport( QStringList const & lists, QString const & config_path );
+    static int  ServeDns( quint16 port, QString const & upstream, QString const & config_path );
+    static bool ReadOperations( QString const & filename, QVector<AliasStore::DomainMove> & moves,
+                                int & malformed_lines, QString & error );
+};
+
+#endif // BATCH_RUNNER_HPP
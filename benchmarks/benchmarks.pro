@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Load/save benchmarks for the GUI-free core. Run the binary with --help
+# for its options; results are written as JSON.
+#
+#-------------------------------------------------
+
+QT       += core concurrent network
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = hosts_benchmark
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../core.pri)
+
+SOURCES += hosts_benchmark.cpp
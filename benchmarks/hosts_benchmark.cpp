@@ -0,0 +1,289 @@
+// Times the load, parse and save paths of the core against synthetic hosts files
+// and configs, and prints the results as JSON so runs can be compared over time.
+//
+//   hosts_benchmark [--sizes 1000,100000,1000000] [--repeat 5] [--output results.json]
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QUdpSocket>
+#include <QtEndian>
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+#include "alias_store.hpp"
+#include "blocklist_importer.hpp"
+#include "config_snapshot.hpp"
+#include "config_writer.hpp"
+#include "dns_responder.hpp"
+#include "dns_table.hpp"
+#include "hosts_parser.hpp"
+
+namespace {
+    int const s_repoints_per_run = 1000;
+    int const s_dns_queries_per_run = 100000;
+    int const s_udp_queries_per_run = 20000;
+    // queries kept in flight against the loopback responder, like a busy stub resolver
+    int const s_udp_window = 64;
+    int const s_fanout_targets = 16;
+
+    struct Benchmark {
+        QString                name;
+        int                    entries;
+        std::function<void()>  setup; // not timed
+        std::function<void()>  body;
+    };
+
+    bool WriteSyntheticHostsFile( QString const & filename, int entries )
+    {
+        QFile file{ filename };
+        if( !file.open( QIODevice::WriteOnly ) ) return false;
+        QByteArray buffer {};
+        buffer.reserve( 1 << 20 );
+        buffer.append( "# synthetic hosts file\n127.0.0.1 localhost\n" );
+        for( int i = 0; i != entries; ++i ){
+            buffer.append( "10.0.0." ).append( QByteArray::number( i % 16 ) ).append( '\t' )
+                    .append( "host" ).append( QByteArray::number( i ) )
+                    .append( ".zone" ).append( QByteArray::number( i % 97 ) ).append( ".example.com\n" );
+            if( buffer.size() > ( 1 << 20 ) ){
+                file.write( buffer );
+                buffer.clear();
+            }
+        }
+        file.write( buffer );
+        return true;
+    }
+
+    // an A query for `name` with `id`, RD set
+    QByteArray MakeDnsQuery( QByteArray const & name, quint16 id )
+    {
+        QByteArray query( 12, '\0' );
+        qToBigEndian<quint16>( id, reinterpret_cast<uchar *>( query.data() ) );
+        qToBigEndian<quint16>( 0x0100, reinterpret_cast<uchar *>( query.data() + 2 ) );
+        qToBigEndian<quint16>( 1, reinterpret_cast<uchar *>( query.data() + 4 ) );
+        for( auto const & label: name.split( '.' ) ){
+            query.append( static_cast<char>( label.size() ) ).append( label );
+        }
+        query.append( '\0' ).append( "\0\1\0\1", 4 );
+        return query;
+    }
+
+    // sends `count` queries over UDP keeping `s_udp_window` unanswered at a time; false when
+    // the responder stops answering
+    bool RunUdpQueries( QUdpSocket & socket, quint16 port, QVector<QByteArray> const & queries, int count )
+    {
+        QByteArray datagram( 65536, '\0' );
+        int sent = 0, received = 0;
+        while( received != count ){
+            while( sent != count && sent - received < s_udp_window ){
+                socket.writeDatagram( queries[sent % queries.size()], QHostAddress::LocalHost, port );
+                ++sent;
+            }
+            if( !socket.hasPendingDatagrams() && !socket.waitForReadyRead( 1000 ) ) return false;
+            while( socket.hasPendingDatagrams() ){
+                socket.readDatagram( datagram.data(), datagram.size() );
+                ++received;
+            }
+        }
+        return true;
+    }
+
+    QJsonObject Run( Benchmark const & benchmark, int repeat )
+    {
+        QVector<double> runs {};
+        QElapsedTimer timer {};
+        for( int i = 0; i != repeat; ++i ){
+            if( benchmark.setup ) benchmark.setup();
+            timer.start();
+            benchmark.body();
+            runs.append( timer.nsecsElapsed() / 1e6 );
+        }
+        std::sort( runs.begin(), runs.end() );
+        double total = 0;
+        for( double const run: runs ) total += run;
+
+        using Pair = QPair<QString, QJsonValue>;
+        return QJsonObject( { Pair( "name", benchmark.name ),
+                              Pair( "entries", benchmark.entries ),
+                              Pair( "runs", repeat ),
+                              Pair( "min_ms", runs.first() ),
+                              Pair( "median_ms", runs[runs.size() / 2] ),
+                              Pair( "mean_ms", total / runs.size() )
+                            });
+    }
+}
+
+int main( int argc, char *argv[] )
+{
+    QCoreApplication app( argc, argv );
+    QTextStream err{ stderr };
+
+    QList<int> sizes { 1000, 100000, 1000000 };
+    int repeat = 5;
+    QString output_filename {};
+    QStringList const arguments = QCoreApplication::arguments();
+    for( int i = 1; i < arguments.size(); ++i ){
+        if( arguments[i] == "--sizes" && i + 1 < arguments.size() ){
+            sizes.clear();
+            for( auto const & size: arguments[++i].split( ',' ) ) sizes.append( size.toInt() );
+        } else if( arguments[i] == "--repeat" && i + 1 < arguments.size() ){
+            repeat = qMax( 1, arguments[++i].toInt() );
+        } else if( arguments[i] == "--output" && i + 1 < arguments.size() ){
+            output_filename = arguments[++i];
+        } else {
+            err << "usage: " << arguments[0] << " [--sizes 1000,100000,1000000] [--repeat 5] [--output file]\n";
+            return 2;
+        }
+    }
+
+    QTemporaryDir directory {};
+    if( !directory.isValid() ){
+        err << "unable to create a temporary directory\n";
+        return 1;
+    }
+
+    QJsonArray results {};
+    for( int const entries: sizes ){
+        QString const hosts_path = directory.filePath( QString( "hosts_%1" ).arg( entries ) );
+        QString const config_path = directory.filePath( QString( "config_%1.json" ).arg( entries ) );
+        QString const hosts_output = directory.filePath( QString( "hosts_out_%1" ).arg( entries ) );
+        if( !WriteSyntheticHostsFile( hosts_path, entries ) ){
+            err << "unable to write " << hosts_path << "\n";
+            return 1;
+        }
+
+        HostsMapping mapping {};
+        QString error {};
+        QStringList warnings {};
+        AliasStore store {};
+        if( !HostsParser::ParseFile( hosts_path, mapping ) ||
+                !AliasStore::WriteConfigFromMapping( config_path, hosts_path, mapping, error ) ||
+                !store.Load( config_path, error, warnings ) ){
+            err << "unable to prepare the " << entries << " entries config: " << error << "\n";
+            return 1;
+        }
+        ConfigState const loaded_state = store.State( config_path );
+        ConfigState state = loaded_state;
+        state.hosts_file_path = hosts_output;
+        QStringList const alias_names = store.Aliases().keys();
+        // the same write with container/chroot copies, close to the single write if the fan-out works
+        ConfigState fanout_state = state;
+        for( int i = 0; i != s_fanout_targets; ++i ){
+            fanout_state.hosts_file_targets.append( directory.filePath( QString( "hosts_out_%1.%2" ).arg( entries ).arg( i ) ) );
+        }
+
+        DnsTable dns_table {};
+        dns_table.Sync( store.Snapshot() );
+        DnsResponder dns_responder{ dns_table };
+        if( !dns_responder.Start( 0, QString(), error ) ){
+            err << "unable to start the DNS responder: " << error << "\n";
+            return 1;
+        }
+        QUdpSocket dns_client {};
+        dns_client.bind( QHostAddress::LocalHost, 0 );
+        // every tenth name is unknown and takes the NXDOMAIN path
+        QVector<QByteArray> dns_queries {};
+        for( int i = 0; i != 1024; ++i ){
+            int const host = i * 7919 % entries;
+            dns_queries.append( MakeDnsQuery( i % 10 == 9 ? QByteArray( "unknown.invalid" ) :
+                                              QString( "host%1.zone%2.example.com" ).arg( host ).arg( host % 97 ).toUtf8(),
+                                              static_cast<quint16>( i ) ) );
+        }
+
+        auto remove_snapshot = [&]{ QFile::remove( ConfigSnapshot::SnapshotPath( config_path ) ); };
+        auto fatal = [&]( bool ok ){ if( !ok ){ err << error << "\n"; std::exit( 1 ); } };
+        auto write_snapshot = [&]{ fatal( ConfigSnapshot::Write( loaded_state ) ); };
+
+        QList<Benchmark> const benchmarks {
+            { "ReadHostsFile/serial", entries, nullptr, [&]{
+                HostsMapping parsed {};
+                HostsParser::ParseFile( hosts_path, parsed, HostsParser::ImportMode::Serial );
+            } },
+            { "ReadHostsFile/parallel", entries, nullptr, [&]{
+                HostsMapping parsed {};
+                HostsParser::ParseFile( hosts_path, parsed, HostsParser::ImportMode::Parallel );
+            } },
+            { "ImportBlocklists/x2", entries, nullptr, [&]{
+                // the second list repeats the first, so half the entries take the duplicate path
+                BlocklistImporter importer {};
+                importer.AddFile( hosts_path );
+                importer.AddFile( hosts_path );
+            } },
+            { "WriteHostFileToConfigFile", entries, nullptr, [&]{
+                fatal( AliasStore::WriteConfigFromMapping( config_path, hosts_path, mapping, error ) );
+            } },
+            // the JSON path alone: writing the snapshot it would leave behind is timed below
+            { "ReadConfigFile/json", entries, remove_snapshot, [&]{
+                AliasStore loaded {};
+                fatal( loaded.Load( config_path, error, warnings, AliasStore::SnapshotMode::ReadOnly ) );
+            } },
+            { "ReadConfigFile/snapshot", entries, write_snapshot, [&]{
+                AliasStore loaded {};
+                fatal( loaded.Load( config_path, error, warnings ) );
+            } },
+            { "WriteConfigSnapshot", entries, nullptr, [&]{
+                fatal( ConfigSnapshot::Write( loaded_state ) );
+            } },
+            { "SyncConfigFile", entries, nullptr, [&]{
+                fatal( ConfigWriter::WriteConfigFile( state, error ) );
+            } },
+            { "SyncConfigWithHostsFile", entries, nullptr, [&]{
+                fatal( ConfigWriter::WriteHostsFile( state, error ) );
+            } },
+            { QString( "SyncConfigWithHostsFile/targets x%1" ).arg( s_fanout_targets ), entries, nullptr, [&]{
+                fatal( ConfigWriter::WriteHostsFile( fanout_state, error ) );
+            } },
+            { QString( "Repoint/x%1" ).arg( s_repoints_per_run ), entries, nullptr, [&]{
+                for( int i = 0; i != s_repoints_per_run; ++i ){
+                    store.PointDomainTo( QString( "host%1.zone%2.example.com" ).arg( i % entries ).arg( i % entries % 97 ),
+                                         alias_names[i % alias_names.size()] );
+                }
+            } },
+            { QString( "DnsAnswer/x%1" ).arg( s_dns_queries_per_run ), entries, nullptr, [&]{
+                QByteArray reply {};
+                for( int i = 0; i != s_dns_queries_per_run; ++i ){
+                    QByteArray const & query = dns_queries[i % dns_queries.size()];
+                    DnsResponder::Answer( query.constData(), query.size(), dns_table, false, reply );
+                }
+            } },
+            { QString( "DnsUdp/x%1" ).arg( s_udp_queries_per_run ), entries, nullptr, [&]{
+                if( !RunUdpQueries( dns_client, dns_responder.Port(), dns_queries, s_udp_queries_per_run ) ){
+                    err << "the DNS responder stopped answering\n";
+                    std::exit( 1 );
+                }
+            } }
+        };
+        for( auto const & benchmark: benchmarks ){
+            err << benchmark.name << " @ " << entries << "\n";
+            err.flush();
+            results.append( Run( benchmark, repeat ) );
+        }
+    }
+
+    using Pair = QPair<QString, QJsonValue>;
+    QJsonObject const report( { Pair( "timestamp", QDateTime::currentDateTimeUtc().toString( Qt::ISODate ) ),
+                                Pair( "qt_version", QString( qVersion() ) ),
+                                Pair( "cpu", QSysInfo::currentCpuArchitecture() ),
+                                Pair( "os", QSysInfo::prettyProductName() ),
+                                Pair( "results", results )
+                              });
+    QByteArray const json = QJsonDocument( report ).toJson();
+    if( output_filename.isEmpty() ){
+        QTextStream{ stdout } << json;
+        return 0;
+    }
+    QFile output{ output_filename };
+    if( !output.open( QIODevice::WriteOnly ) || output.write( json ) != json.size() ){
+        err << output_filename << ": " << output.errorString() << "\n";
+        return 1;
+    }
+    return 0;
+}
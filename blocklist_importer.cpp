@@ -0,0 +1,186 @@
+#include "blocklist_importer.hpp"
+#include "domain_pool.hpp"
+#include "hosts_scanner.hpp"
+#include "statistics.hpp"
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <cstring>
+#include <limits>
+
+quint32 const BlocklistImporter::s_empty_slot = std::numeric_limits<quint32>::max();
+
+BlocklistImporter::BlocklistImporter(): mapping{}, bytes{}, offsets{ 0 }, hashes{}, addresses{},
+    slots( 1 << 16, s_empty_slot ), scratch{}
+{
+}
+
+BlocklistImporter::SourceStats BlocklistImporter::AddFile( QString const & filename )
+{
+    SourceStats stats{ filename, false, 0, 0, 0, 0, 0 };
+    QFile file{ filename };
+    if( !file.open( QIODevice::ReadOnly ) ) return stats;
+    stats.readable = true;
+    qint64 const size = file.size();
+    if( size == 0 ) return stats;
+
+    ScopedTimer const timer{ Statistics::HostsParse };
+    Statistics::Global().AddBytesRead( Statistics::HostsParse, size );
+
+    uchar *mapped = file.map( 0, size );
+    if( mapped ){
+        AddBuffer( reinterpret_cast<char const *>( mapped ), size, stats );
+        file.unmap( mapped );
+    } else { // pipes and special files can't be mapped
+        QByteArray const content = file.readAll();
+        AddBuffer( content.constData(), content.size(), stats );
+    }
+    return stats;
+}
+
+void BlocklistImporter::AddBuffer( char const * data, qint64 size, SourceStats & stats )
+{
+    static HostsScanner const scanner {};
+
+    if( size >= 3 && std::memcmp( data, "\xEF\xBB\xBF", 3 ) == 0 ){
+        data += 3;
+        size -= 3;
+    }
+
+    // as in HostsParser, consecutive lines almost always share their address
+    char const *last_ip = nullptr;
+    std::size_t last_ip_length = 0;
+    bool last_ip_valid = false;
+    IpAddress address {};
+    HostsMapping::iterator target = mapping.end();
+
+    scanner.Scan( data, static_cast<std::size_t>( size ),
+                  [&]( HostsScanner::Field const * fields, std::size_t count )
+    {
+        if( count < 2 ) return;
+        char const *ip = data + fields[0].offset;
+        std::size_t const ip_length = fields[0].length;
+        if( last_ip == nullptr || ip_length != last_ip_length || std::memcmp( ip, last_ip, ip_length ) != 0 ){
+            last_ip = ip;
+            last_ip_length = ip_length;
+            last_ip_valid = IpAddress::Parse( ip, static_cast<int>( ip_length ), address );
+            target = mapping.end();
+        }
+        if( !last_ip_valid ){
+            ++stats.invalid_lines;
+            return;
+        }
+
+        for( std::size_t i = 1; i != count; ++i ){
+            Normalize( data + fields[i].offset, fields[i].length, scratch );
+            if( scratch.empty() ) continue;
+            ++stats.entries;
+
+            quint32 const length = static_cast<quint32>( scratch.size() );
+            uint const hash = qHashBits( scratch.data(), scratch.size() );
+            std::size_t const slot = Probe( scratch.data(), length, hash );
+            if( slots[slot] != s_empty_slot ){
+                if( addresses[slots[slot]] == address ) ++stats.duplicates;
+                else ++stats.conflicts;
+                continue;
+            }
+
+            slots[slot] = static_cast<quint32>( hashes.size() );
+            bytes.insert( bytes.end(), scratch.begin(), scratch.end() );
+            offsets.push_back( static_cast<quint32>( bytes.size() ) );
+            hashes.push_back( hash );
+            addresses.push_back( address );
+            // at most half full, so a miss ends after a probe or two
+            if( hashes.size() * 2 > slots.size() ) Rehash( slots.size() * 2 );
+
+            if( target == mapping.end() ){
+                target = mapping.find( address );
+                if( target == mapping.end() ) target = mapping.insert( address, QList<QString>{} );
+            }
+            target->append( QString::fromUtf8( scratch.data(), static_cast<int>( length ) ) );
+            ++stats.unique;
+        }
+    });
+    Statistics::Global().AddEntries( Statistics::HostsParse, stats.entries );
+}
+
+qint64 BlocklistImporter::DropOwned( AliasSnapshot const & snapshot )
+{
+    DomainPool const &pool = DomainPool::Global();
+    QSet<QByteArray> owned {}, suffixes {};
+    for( auto const & alias: snapshot.aliases ){
+        for( DomainId const id: alias->GetDomainNames() ) owned.insert( pool.Utf8( id ).toLower() );
+        for( auto const & pattern: alias->Wildcards() ) suffixes.insert( pattern.mid( 2 ).toLower().toUtf8() );
+    }
+    if( owned.isEmpty() && suffixes.isEmpty() ) return 0;
+
+    qint64 dropped = 0;
+    for( auto iter = mapping.begin(); iter != mapping.end(); ){
+        QList<QString> kept {};
+        for( auto const & domain: iter.value() ){
+            QByteArray const name = domain.toUtf8();
+            bool taken = owned.contains( name );
+            // as in AliasStore::AddHostsUnder, a rule only covers names strictly below it
+            for( int i = 0; !taken && i != name.size(); ++i ){
+                if( name[i] != '.' ) continue;
+                taken = suffixes.contains( QByteArray::fromRawData( name.constData() + i + 1, name.size() - i - 1 ) );
+            }
+            if( taken ) ++dropped;
+            else kept.append( domain );
+        }
+        if( kept.isEmpty() ){
+            iter = mapping.erase( iter );
+        } else {
+            iter.value() = std::move( kept );
+            ++iter;
+        }
+    }
+    return dropped;
+}
+
+HostsMapping const & BlocklistImporter::Mapping() const
+{
+    return mapping;
+}
+
+int BlocklistImporter::UniqueCount() const
+{
+    return static_cast<int>( hashes.size() );
+}
+
+void BlocklistImporter::Normalize( char const * name, std::size_t length, std::vector<char> & normalized )
+{
+    // "Ads.Example.COM." and "ads.example.com" are the same host. Only ASCII is folded,
+    // internationalized names appear in hosts files as punycode anyway
+    while( length != 0 && name[length - 1] == '.' ) --length;
+    normalized.resize( length );
+    for( std::size_t i = 0; i != length; ++i ){
+        char const c = name[i];
+        normalized[i] = c >= 'A' && c <= 'Z' ? static_cast<char>( c + ( 'a' - 'A' ) ) : c;
+    }
+}
+
+std::size_t BlocklistImporter::Probe( char const * name, quint32 length, uint hash ) const
+{
+    std::size_t const mask = slots.size() - 1;
+    for( std::size_t index = hash & mask; ; index = ( index + 1 ) & mask ){
+        quint32 const id = slots[index];
+        if( id == s_empty_slot ) return index;
+        if( hashes[id] != hash ) continue;
+        quint32 const begin = offsets[id], end = offsets[id + 1];
+        if( end - begin == length && std::memcmp( bytes.data() + begin, name, length ) == 0 ){
+            return index;
+        }
+    }
+}
+
+void BlocklistImporter::Rehash( std::size_t new_capacity )
+{
+    std::vector<quint32>( new_capacity, s_empty_slot ).swap( slots );
+    std::size_t const mask = new_capacity - 1;
+    for( quint32 id = 0; id != hashes.size(); ++id ){
+        std::size_t index = hashes[id] & mask;
+        while( slots[index] != s_empty_slot ) index = ( index + 1 ) & mask;
+        slots[index] = id;
+    }
+}
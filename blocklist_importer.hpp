@@ -0,0 +1,58 @@
+#ifndef BLOCKLIST_IMPORTER_HPP
+#define BLOCKLIST_IMPORTER_HPP
+
+#include <QString>
+#include <QVector>
+#include <vector>
+
+#include "alias_snapshot.hpp"
+#include "hosts_parser.hpp"
+
+// Merges many hosts-format blocklists into one mapping, dropping repeats while the lists
+// are read. Names are compared lowercased and without their trailing dot, the first list
+// to name a host decides where it points.
+class BlocklistImporter
+{
+public:
+    struct SourceStats {
+        QString path;
+        bool    readable;
+        qint64  entries;       // host names read
+        qint64  unique;        // not seen in an earlier list or line
+        qint64  duplicates;    // seen before, pointing to the same address
+        qint64  conflicts;     // seen before, pointing elsewhere. The earlier entry is kept
+        qint64  invalid_lines; // the first field isn't an address
+    };
+
+    BlocklistImporter();
+
+    // lists are merged in the order they are added
+    SourceStats AddFile( QString const & filename );
+    void        AddBuffer( char const * data, qint64 size, SourceStats & stats );
+
+    // takes out every name the config already decides, whether an alias points it or one
+    // of its rules covers it, so an import never moves what the user placed. Config names
+    // match ignoring case. Returns how many were taken out
+    qint64 DropOwned( AliasSnapshot const & snapshot );
+
+    // normalized names, each listed once under the address it was first seen with
+    HostsMapping const & Mapping() const;
+    int                  UniqueCount() const;
+private:
+    static void Normalize( char const * name, std::size_t length, std::vector<char> & normalized );
+    // index of the slot holding the name, or of the empty slot it would go in
+    std::size_t Probe( char const * name, quint32 length, uint hash ) const;
+    void        Rehash( std::size_t new_capacity );
+
+    static quint32 const s_empty_slot;
+
+    HostsMapping          mapping;
+    std::vector<char>     bytes;     // every unique name, back to back
+    std::vector<quint32>  offsets;   // name i is bytes[offsets[i], offsets[i + 1])
+    std::vector<uint>     hashes;    // per name, so growing the table reads no names
+    std::vector<IpAddress> addresses; // per name, where it was first pointed
+    std::vector<quint32>  slots;     // open addressing, linear probing
+    std::vector<char>     scratch;
+};
+
+#endif // BLOCKLIST_IMPORTER_HPP
@@ -0,0 +1,368 @@
+#include "config_journal.hpp"
+#include "alias_store.hpp"
+#include "statistics.hpp"
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QtEndian>
+#include <algorithm>
+
+#if defined( Q_OS_WIN )
+#include <io.h>
+#include <windows.h>
+#elif defined( Q_OS_UNIX )
+#include <unistd.h>
+#endif
+
+namespace {
+    // payload length, payload checksum
+    int const s_frame_size = 4 + 4;
+
+    QByteArray Frame( QByteArray const & payload, quint32 checksum )
+    {
+        uchar frame[s_frame_size];
+        qToLittleEndian<quint32>( static_cast<quint32>( payload.size() ), frame );
+        qToLittleEndian<quint32>( checksum, frame + 4 );
+        return QByteArray( reinterpret_cast<char const *>( frame ), s_frame_size ) + payload;
+    }
+
+    void WriteMapping( QDataStream & stream, HostsMapping const & mapping )
+    {
+        stream << static_cast<quint32>( mapping.size() );
+        for( auto iter = mapping.cbegin(); iter != mapping.cend(); ++iter ){
+            stream << iter.key().High() << iter.key().Low() << iter.value();
+        }
+    }
+
+    // flush() only hands the bytes to the OS, a journaled change has to outlive it too
+    bool SyncToDisk( QFile & file )
+    {
+#if defined( Q_OS_WIN )
+        return FlushFileBuffers( reinterpret_cast<HANDLE>( _get_osfhandle( file.handle() ) ) ) != 0;
+#elif defined( Q_OS_UNIX )
+        return ::fsync( file.handle() ) == 0;
+#else
+        return true;
+#endif
+    }
+
+    void WriteProfile( QDataStream & stream, Profile const & profile )
+    {
+        DomainPool const &pool = DomainPool::Global();
+        stream << static_cast<quint32>( profile.aliases.size() );
+        for( auto const & alias: profile.aliases ){
+            QStringList domains {};
+            for( DomainId const id: alias.GetDomainNames() ) domains.append( pool.Name( id ) );
+            stream << alias.Name() << alias.HasAddress() << alias.Address().High() << alias.Address().Low()
+                   << alias.UnparsedAddress() << domains << alias.Wildcards();
+        }
+        stream << static_cast<quint32>( profile.wildcard_hosts.size() );
+        for( auto iter = profile.wildcard_hosts.cbegin(); iter != profile.wildcard_hosts.cend(); ++iter ){
+            QStringList hosts {};
+            for( DomainId const id: iter.value() ) hosts.append( pool.Name( id ) );
+            stream << iter.key() << hosts;
+        }
+    }
+
+    Profile ReadProfile( QDataStream & stream )
+    {
+        DomainPool &pool = DomainPool::Global();
+        Profile profile{ {}, {}, 0 };
+        quint32 alias_count = 0;
+        stream >> alias_count;
+        for( quint32 i = 0; i != alias_count && stream.status() == QDataStream::Ok; ++i ){
+            QString name {}, unparsed_ip {};
+            bool has_address = true;
+            quint64 high = 0, low = 0;
+            QStringList domains {}, wildcards {};
+            stream >> name >> has_address >> high >> low >> unparsed_ip >> domains >> wildcards;
+            Alias alias = has_address ? Alias{ name, IpAddress::FromBits( high, low ) } : Alias::Unparsed( name, unparsed_ip );
+            std::vector<DomainId> ids {};
+            ids.reserve( static_cast<std::size_t>( domains.size() ) );
+            for( auto const & domain: domains ) ids.push_back( pool.Intern( domain ) );
+            alias.SetDomains( std::move( ids ) );
+            for( auto const & pattern: wildcards ) alias.InsertWildcard( pattern );
+            profile.aliases.insert( name, alias );
+        }
+        quint32 rule_count = 0;
+        stream >> rule_count;
+        for( quint32 i = 0; i != rule_count && stream.status() == QDataStream::Ok; ++i ){
+            QString pattern {};
+            QStringList hosts {};
+            stream >> pattern >> hosts;
+            std::vector<DomainId> &ids = profile.wildcard_hosts[pattern];
+            for( auto const & host: hosts ) ids.push_back( pool.Intern( host ) );
+            std::sort( ids.begin(), ids.end() );
+        }
+        return profile;
+    }
+
+    HostsMapping ReadMapping( QDataStream & stream )
+    {
+        HostsMapping mapping {};
+        quint32 size = 0;
+        stream >> size;
+        for( quint32 i = 0; i != size && stream.status() == QDataStream::Ok; ++i ){
+            quint64 high = 0, low = 0;
+            QList<QString> domains {};
+            stream >> high >> low >> domains;
+            mapping.insert( IpAddress::FromBits( high, low ), domains );
+        }
+        return mapping;
+    }
+}
+
+// a few hundred thousand repoints, or one large import, before config.json is rewritten
+qint64 const ConfigJournal::s_compact_threshold = 4 << 20;
+
+ConfigJournal::ConfigJournal(): config_path{}, file{}, generation{ 1 }, uncompacted_bytes{ 0 }
+{
+}
+
+QString ConfigJournal::FilePath( QString const & config_path, quint64 generation )
+{
+    return config_path + ".journal." + QString::number( generation );
+}
+
+QList<quint64> ConfigJournal::Generations( QString const & config_path )
+{
+    QFileInfo const config{ config_path };
+    QString const prefix = config.fileName() + ".journal.";
+    QList<quint64> generations {};
+    for( auto const & name: QDir( config.absolutePath() ).entryList( QStringList{ prefix + "*" }, QDir::Files ) ){
+        bool valid = false;
+        quint64 const generation = name.mid( prefix.size() ).toULongLong( &valid );
+        if( valid && generation != 0 ) generations.append( generation );
+    }
+    std::sort( generations.begin(), generations.end() );
+    return generations;
+}
+
+quint32 ConfigJournal::Checksum( char const * data, int size )
+{
+    // FNV-1a, it only has to catch torn records
+    quint32 hash = 2166136261U;
+    for( int i = 0; i != size; ++i ) hash = ( hash ^ static_cast<uchar>( data[i] ) ) * 16777619U;
+    return hash;
+}
+
+QByteArray ConfigJournal::AddAliasRecord( QString const & name, IpAddress const & address )
+{
+    QByteArray payload {};
+    QDataStream stream{ &payload, QIODevice::WriteOnly };
+    stream << static_cast<quint8>( AddAlias ) << name << address.High() << address.Low();
+    return payload;
+}
+
+QByteArray ConfigJournal::SetAddressRecord( QString const & name, IpAddress const & address )
+{
+    QByteArray payload {};
+    QDataStream stream{ &payload, QIODevice::WriteOnly };
+    stream << static_cast<quint8>( SetAddress ) << name << address.High() << address.Low();
+    return payload;
+}
+
+QByteArray ConfigJournal::PointDomainRecord( QString const & domain_name, QString const & alias_name )
+{
+    QByteArray payload {};
+    QDataStream stream{ &payload, QIODevice::WriteOnly };
+    stream << static_cast<quint8>( PointDomain ) << domain_name << alias_name;
+    return payload;
+}
+
+QByteArray ConfigJournal::PointDomainsRecord( QVector<QPair<QString, QString>> const & moves )
+{
+    QByteArray payload {};
+    QDataStream stream{ &payload, QIODevice::WriteOnly };
+    stream << static_cast<quint8>( PointDomains ) << moves;
+    return payload;
+}
+
+QByteArray ConfigJournal::PointSubtreeRecord( QString const & pattern, QString const & alias_name )
+{
+    QByteArray payload {};
+    QDataStream stream{ &payload, QIODevice::WriteOnly };
+    stream << static_cast<quint8>( PointSubtree ) << pattern << alias_name;
+    return payload;
+}
+
+QByteArray ConfigJournal::SaveProfileRecord( QString const & name, Profile const & profile )
+{
+    QByteArray payload {};
+    QDataStream stream{ &payload, QIODevice::WriteOnly };
+    stream << static_cast<quint8>( SaveProfile ) << name;
+    WriteProfile( stream, profile );
+    return payload;
+}
+
+QByteArray ConfigJournal::SwitchProfileRecord( QString const & name )
+{
+    QByteArray payload {};
+    QDataStream stream{ &payload, QIODevice::WriteOnly };
+    stream << static_cast<quint8>( SwitchProfile ) << name;
+    return payload;
+}
+
+QByteArray ConfigJournal::MergeEntriesRecord( HostsMapping const & added, HostsMapping const & removed )
+{
+    QByteArray payload {};
+    QDataStream stream{ &payload, QIODevice::WriteOnly };
+    stream << static_cast<quint8>( MergeEntries );
+    WriteMapping( stream, added );
+    WriteMapping( stream, removed );
+    return payload;
+}
+
+bool ConfigJournal::Apply( QByteArray const & payload, AliasStore & store )
+{
+    QDataStream stream{ payload };
+    quint8 type = 0;
+    stream >> type;
+    switch( type ){
+    case AddAlias:
+    case SetAddress: {
+        QString name {};
+        quint64 high = 0, low = 0;
+        stream >> name >> high >> low;
+        if( stream.status() != QDataStream::Ok ) return false;
+        if( type == AddAlias ) store.AddAlias( name, IpAddress::FromBits( high, low ) );
+        else store.SetAliasAddress( name, IpAddress::FromBits( high, low ) );
+        return true;
+    }
+    case PointDomain:
+    case PointSubtree: {
+        QString name {}, alias_name {};
+        stream >> name >> alias_name;
+        if( stream.status() != QDataStream::Ok ) return false;
+        if( type == PointDomain ) store.PointDomainTo( name, alias_name );
+        else store.PointSubtreeTo( name, alias_name );
+        return true;
+    }
+    case PointDomains: {
+        QVector<QPair<QString, QString>> moves {};
+        stream >> moves;
+        if( stream.status() != QDataStream::Ok ) return false;
+        store.PointDomainsTo( moves );
+        return true;
+    }
+    case SaveProfile: {
+        QString name {};
+        stream >> name;
+        Profile const profile = ReadProfile( stream );
+        if( stream.status() != QDataStream::Ok ) return false;
+        store.RestoreProfile( name, profile );
+        return true;
+    }
+    case SwitchProfile: {
+        QString name {};
+        stream >> name;
+        if( stream.status() != QDataStream::Ok ) return false;
+        store.SwitchToProfile( name );
+        return true;
+    }
+    case MergeEntries: {
+        HostsMapping const added = ReadMapping( stream );
+        HostsMapping const removed = ReadMapping( stream );
+        if( stream.status() != QDataStream::Ok ) return false;
+        store.MergeHostsEntries( added, removed );
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+quint64 ConfigJournal::Replay( QString const & config_path, AliasStore & store, QStringList & warnings,
+                               qint64 & bytes )
+{
+    bytes = 0;
+    quint64 newest = 0;
+    for( quint64 const generation: Generations( config_path ) ){
+        newest = generation;
+        QFile file{ FilePath( config_path, generation ) };
+        if( !file.open( QIODevice::ReadOnly ) ){
+            warnings.append( file.fileName() + ": " + file.errorString() );
+            continue;
+        }
+        QByteArray const content = file.readAll();
+        file.close();
+        bytes += content.size();
+
+        int offset = 0;
+        while( offset < content.size() ){
+            uchar const *frame = reinterpret_cast<uchar const *>( content.constData() + offset );
+            if( content.size() - offset < s_frame_size ) break;
+            quint32 const size = qFromLittleEndian<quint32>( frame );
+            if( size > static_cast<quint32>( content.size() - offset - s_frame_size ) ) break;
+            char const *payload = content.constData() + offset + s_frame_size;
+            if( qFromLittleEndian<quint32>( frame + 4 ) != Checksum( payload, static_cast<int>( size ) ) ) break;
+            if( !Apply( QByteArray::fromRawData( payload, static_cast<int>( size ) ), store ) ){
+                warnings.append( QString( "%1: unreadable change at byte %2, skipped" )
+                                 .arg( file.fileName() ).arg( offset ) );
+            }
+            offset += s_frame_size + static_cast<int>( size );
+        }
+        if( offset < content.size() ){
+            // the tail of the last write before a crash, the changes before it are intact
+            warnings.append( QString( "%1: the last %2 bytes were cut short and have been ignored" )
+                             .arg( file.fileName() ).arg( content.size() - offset ) );
+        }
+    }
+    // timed as part of the load that replays it
+    Statistics::Global().AddBytesRead( Statistics::ConfigLoad, bytes );
+    return newest;
+}
+
+void ConfigJournal::Discard( QString const & config_path, quint64 generation )
+{
+    for( quint64 const existing: Generations( config_path ) ){
+        if( existing > generation ) break;
+        QFile::remove( FilePath( config_path, existing ) );
+    }
+}
+
+void ConfigJournal::Open( QString const & config_path_, quint64 generation_, qint64 uncompacted_bytes_ )
+{
+    if( file.isOpen() ) file.close();
+    config_path = config_path_;
+    generation = qMax<quint64>( 1, generation_ );
+    uncompacted_bytes = uncompacted_bytes_;
+}
+
+bool ConfigJournal::Append( QVector<QByteArray> const & records, QString & error )
+{
+    if( records.isEmpty() ) return true;
+    if( !file.isOpen() ){
+        file.setFileName( FilePath( config_path, generation ) );
+        if( !file.open( QIODevice::WriteOnly | QIODevice::Append ) ){
+            error = file.errorString();
+            return false;
+        }
+    }
+    QByteArray buffer {};
+    for( auto const & record: records ) buffer.append( Frame( record, Checksum( record.constData(), record.size() ) ) );
+
+    ScopedTimer const timer{ Statistics::FileWrite };
+    if( file.write( buffer ) != buffer.size() || !file.flush() || !SyncToDisk( file ) ){
+        error = file.errorString();
+        // whatever part of it landed is a torn record to the next replay
+        file.close();
+        ++generation;
+        return false;
+    }
+    Statistics::Global().AddBytesWritten( Statistics::FileWrite, buffer.size() );
+    uncompacted_bytes += buffer.size();
+    return true;
+}
+
+quint64 ConfigJournal::Rotate()
+{
+    if( file.isOpen() ) file.close();
+    uncompacted_bytes = 0;
+    return generation++;
+}
+
+qint64 ConfigJournal::UncompactedBytes() const
+{
+    return uncompacted_bytes;
+}
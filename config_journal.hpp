@@ -0,0 +1,84 @@
+#ifndef CONFIG_JOURNAL_HPP
+#define CONFIG_JOURNAL_HPP
+
+#include <QByteArray>
+#include <QFile>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "config_writer.hpp"
+#include "hosts_parser.hpp"
+
+class AliasStore;
+
+// The changes made since config.json was last written, kept as small records appended
+// to config.json.journal.<generation> files next to it, so a change costs the size of the
+// change rather than a rewrite of the whole config. Loading replays every journal file on
+// top of config.json; writing config.json from a state that includes a generation makes
+// that generation's files( and older ones ) redundant, see Discard.
+//
+// Each record is framed by its length and a checksum, a record cut short by a crash is
+// dropped along with anything after it in the same file. Records say what a change ended
+// in( "domain -> alias" ) rather than how to get there, so replaying one that config.json
+// already includes changes nothing.
+class ConfigJournal
+{
+public:
+    // built by AliasStore as it changes
+    static QByteArray AddAliasRecord( QString const & name, IpAddress const & address );
+    static QByteArray SetAddressRecord( QString const & name, IpAddress const & address );
+    static QByteArray PointDomainRecord( QString const & domain_name, QString const & alias_name );
+    static QByteArray PointDomainsRecord( QVector<QPair<QString, QString>> const & moves );
+    static QByteArray PointSubtreeRecord( QString const & pattern, QString const & alias_name );
+    // the profile's whole content, replaying it must not pick up whatever the replay has
+    // rebuilt by then
+    static QByteArray SaveProfileRecord( QString const & name, Profile const & profile );
+    static QByteArray SwitchProfileRecord( QString const & name );
+    static QByteArray MergeEntriesRecord( HostsMapping const & added, HostsMapping const & removed );
+
+    // applies the journal files of `config_path` oldest first and returns the newest
+    // generation seen, 0 when there are none. `bytes` receives their total size
+    static quint64 Replay( QString const & config_path, AliasStore & store, QStringList & warnings,
+                           qint64 & bytes );
+    // removes the files up to and including `generation`, once config.json holds them
+    static void    Discard( QString const & config_path, quint64 generation );
+
+    ConfigJournal();
+
+    // appends to `generation` from now on. `uncompacted_bytes` are the older, replayed files
+    void    Open( QString const & config_path, quint64 generation, qint64 uncompacted_bytes );
+    // one write and one sync to disk for the lot, the file is created on first use
+    bool    Append( QVector<QByteArray> const & records, QString & error );
+    // closes the current file and moves on to the next generation. Returns the closed
+    // generation: a config.json written from the state as it is now includes it
+    quint64 Rotate();
+    // journaled since the last Rotate, compared against s_compact_threshold
+    qint64  UncompactedBytes() const;
+
+    static qint64 const s_compact_threshold;
+private:
+    enum RecordType : quint8 {
+        AddAlias = 1,
+        PointDomain,
+        PointDomains,
+        PointSubtree,
+        SaveProfile,
+        SwitchProfile,
+        MergeEntries,
+        SetAddress
+    };
+
+    static QString        FilePath( QString const & config_path, quint64 generation );
+    static QList<quint64> Generations( QString const & config_path );
+    static quint32        Checksum( char const * data, int size );
+    static bool           Apply( QByteArray const & payload, AliasStore & store );
+
+    QString config_path;
+    QFile   file;
+    quint64 generation;
+    qint64  uncompacted_bytes;
+};
+
+#endif // CONFIG_JOURNAL_HPP
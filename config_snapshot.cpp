@@ -0,0 +1,268 @@
+#include "config_snapshot.hpp"
+#include "statistics.hpp"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+    char const   s_magic[4] = { 'H', 'F', 'M', 'S' };
+    // magic, version, json size, json mtime, payload size, payload checksum
+    qint64 const s_header_size = 4 + 4 + 8 + 8 + 8 + 8;
+
+    quint64 const s_checksum_seed = 14695981039346656037ULL;
+    // the payload is handed to the file in pieces of about this size
+    int const     s_chunk_size = 1 << 20;
+
+    // FNV-1a, eight bytes at a time; it only has to catch torn or damaged files. Hashing a
+    // payload in pieces gives the same result as long as every piece but the last is a
+    // multiple of eight bytes long and each continues from the hash of the one before
+    quint64 Checksum( uchar const * data, qint64 size, quint64 hash = s_checksum_seed )
+    {
+        qint64 i = 0;
+        for( ; i + 8 <= size; i += 8 ){
+            hash = ( hash ^ qFromLittleEndian<quint64>( data + i ) ) * 1099511628211ULL;
+        }
+        for( ; i < size; ++i ) hash = ( hash ^ data[i] ) * 1099511628211ULL;
+        return hash;
+    }
+
+    template<typename T>
+    void Append( QByteArray & buffer, T value )
+    {
+        uchar bytes[sizeof( T )];
+        qToLittleEndian<T>( value, bytes );
+        buffer.append( reinterpret_cast<char const *>( bytes ), sizeof( T ) );
+    }
+
+    void AppendString( QByteArray & buffer, QByteArray const & utf8 )
+    {
+        Append<quint32>( buffer, static_cast<quint32>( utf8.size() ) );
+        buffer.append( utf8 );
+    }
+
+    // collects the payload and passes it on to the file a chunk at a time, hashing it on the
+    // way, so a snapshot of millions of domains is never held in memory whole
+    struct PayloadWriter {
+        QFileDevice &file;
+        QByteArray   buffer;
+        quint64      checksum;
+        quint64      size;
+        bool         ok;
+
+        explicit PayloadWriter( QFileDevice & device ):
+            file( device ), buffer{}, checksum{ s_checksum_seed }, size{ 0 }, ok{ true } {
+            buffer.reserve( s_chunk_size + 4096 );
+        }
+
+        // writes whatever whole words are buffered once there is a chunk's worth, or
+        // everything when `last`
+        void Flush( bool last = false ){
+            if( !last && buffer.size() < s_chunk_size ) return;
+            int const length = last ? buffer.size() : buffer.size() & ~7;
+            checksum = Checksum( reinterpret_cast<uchar const *>( buffer.constData() ), length, checksum );
+            ok = ok && file.write( buffer.constData(), length ) == length;
+            size += static_cast<quint64>( length );
+            buffer.remove( 0, length );
+        }
+    };
+
+    // bounds-checked cursor over the mapped payload, any overrun clears `ok`
+    struct Reader {
+        uchar const *cursor;
+        uchar const *end;
+        bool         ok;
+
+        template<typename T>
+        T Read(){
+            if( !ok || end - cursor < static_cast<qint64>( sizeof( T ) ) ){
+                ok = false;
+                return T{};
+            }
+            T const value = qFromLittleEndian<T>( cursor );
+            cursor += sizeof( T );
+            return value;
+        }
+
+        bool ReadString( char const *& data, int & length ){
+            quint32 const size = Read<quint32>();
+            if( !ok || static_cast<quint64>( end - cursor ) < size ) return ok = false;
+            data = reinterpret_cast<char const *>( cursor );
+            length = static_cast<int>( size );
+            cursor += size;
+            return true;
+        }
+
+        QString ReadQString(){
+            char const *data = nullptr;
+            int length = 0;
+            return ReadString( data, length ) ? QString::fromUtf8( data, length ) : QString{};
+        }
+    };
+
+    void AppendAliases( PayloadWriter & writer, QMap<QString, Alias> const & aliases,
+                        QHash<QString, std::vector<DomainId>> const & wildcard_hosts )
+    {
+        DomainPool &pool = DomainPool::Global();
+        QByteArray &payload = writer.buffer;
+        Append<quint32>( payload, static_cast<quint32>( aliases.size() ) );
+        for( auto const & alias: aliases ){
+            AppendString( payload, alias.Name().toUtf8() );
+            Append<quint8>( payload, alias.HasAddress() ? 1 : 0 );
+            Append<quint64>( payload, alias.Address().High() );
+            Append<quint64>( payload, alias.Address().Low() );
+            AppendString( payload, alias.UnparsedAddress().toUtf8() );
+            Append<quint32>( payload, static_cast<quint32>( alias.GetDomainNames().size() ) );
+            for( DomainId const id: alias.GetDomainNames() ){
+                AppendString( payload, pool.Utf8( id ) );
+                writer.Flush();
+            }
+            Append<quint32>( payload, static_cast<quint32>( alias.Wildcards().size() ) );
+            for( auto const & pattern: alias.Wildcards() ){
+                AppendString( payload, pattern.toUtf8() );
+                std::vector<DomainId> const hosts = wildcard_hosts.value( pattern );
+                Append<quint32>( payload, static_cast<quint32>( hosts.size() ) );
+                for( DomainId const id: hosts ){
+                    AppendString( payload, pool.Utf8( id ) );
+                    writer.Flush();
+                }
+            }
+        }
+    }
+
+    void ReadAliases( Reader & payload, QMap<QString, Alias> & aliases,
+                      QHash<QString, std::vector<DomainId>> & wildcard_hosts )
+    {
+        DomainPool &pool = DomainPool::Global();
+        quint32 const alias_count = payload.Read<quint32>();
+        char const *domain = nullptr;
+        int length = 0;
+        for( quint32 i = 0; payload.ok && i != alias_count; ++i ){
+            QString const name = payload.ReadQString();
+            bool const has_address = payload.Read<quint8>() != 0;
+            quint64 const high = payload.Read<quint64>();
+            quint64 const low = payload.Read<quint64>();
+            QString const unparsed_ip = payload.ReadQString();
+            Alias alias = has_address ? Alias{ name, IpAddress::FromBits( high, low ) } : Alias::Unparsed( name, unparsed_ip );
+            quint32 const domain_count = payload.Read<quint32>();
+            for( quint32 d = 0; d != domain_count && payload.ReadString( domain, length ); ++d ){
+                alias.InsertDomain( pool.Intern( domain, length ) );
+            }
+            quint32 const wildcard_count = payload.Read<quint32>();
+            for( quint32 w = 0; payload.ok && w != wildcard_count; ++w ){
+                QString const pattern = payload.ReadQString();
+                alias.InsertWildcard( pattern );
+                std::vector<DomainId> &hosts = wildcard_hosts[pattern];
+                quint32 const host_count = payload.Read<quint32>();
+                for( quint32 h = 0; h != host_count && payload.ReadString( domain, length ); ++h ){
+                    hosts.push_back( pool.Intern( domain, length ) );
+                }
+            }
+            aliases.insert( name, alias );
+        }
+    }
+}
+
+quint32 const ConfigSnapshot::s_version = 6;
+
+QString ConfigSnapshot::SnapshotPath( QString const & config_path )
+{
+    return config_path + ".snap";
+}
+
+bool ConfigSnapshot::Write( ConfigState const & state )
+{
+    QFileInfo const json_info{ state.config_path };
+    if( !json_info.exists() ) return false;
+
+    // never leave a half written snapshot behind
+    QSaveFile file{ SnapshotPath( state.config_path ) };
+    if( !file.open( QIODevice::WriteOnly ) ) return false;
+    // the payload's size and checksum are only known at its end, the header is patched then
+    file.write( QByteArray( static_cast<int>( s_header_size ), '\0' ) );
+
+    PayloadWriter payload{ file };
+    AppendString( payload.buffer, state.hosts_file_path.toUtf8() );
+    Append<quint32>( payload.buffer, static_cast<quint32>( state.hosts_file_targets.size() ) );
+    for( auto const & target: state.hosts_file_targets ) AppendString( payload.buffer, target.toUtf8() );
+    AppendAliases( payload, state.aliases, state.wildcard_hosts );
+    Append<quint32>( payload.buffer, static_cast<quint32>( state.profiles.size() ) );
+    for( auto iter = state.profiles.cbegin(); iter != state.profiles.cend(); ++iter ){
+        AppendString( payload.buffer, iter.key().toUtf8() );
+        Append<quint64>( payload.buffer, iter->fingerprint );
+        AppendAliases( payload, iter->aliases, iter->wildcard_hosts );
+    }
+    payload.Flush( true );
+
+    QByteArray header {};
+    header.append( s_magic, sizeof( s_magic ) );
+    Append<quint32>( header, s_version );
+    Append<quint64>( header, static_cast<quint64>( json_info.size() ) );
+    Append<qint64>( header, json_info.lastModified().toMSecsSinceEpoch() );
+    Append<quint64>( header, payload.size );
+    Append<quint64>( header, payload.checksum );
+    Q_ASSERT( header.size() == s_header_size );
+
+    if( !payload.ok || !file.seek( 0 ) || file.write( header ) != header.size() ){
+        file.cancelWriting();
+        return false;
+    }
+    Statistics::Global().AddBytesWritten( Statistics::FileWrite, s_header_size + static_cast<qint64>( payload.size ) );
+    return file.commit();
+}
+
+bool ConfigSnapshot::Read( QString const & config_path, ConfigState & state )
+{
+    QFileInfo const json_info{ config_path };
+    QFile file{ SnapshotPath( config_path ) };
+    if( !json_info.exists() || !file.open( QIODevice::ReadOnly ) ) return false;
+
+    qint64 const size = file.size();
+    if( size < s_header_size ) return false;
+    Statistics::Global().AddBytesRead( Statistics::ConfigLoad, size );
+    uchar *mapped = file.map( 0, size );
+    if( !mapped ) return false;
+
+    Reader header{ mapped, mapped + s_header_size, true };
+    bool valid = std::memcmp( mapped, s_magic, sizeof( s_magic ) ) == 0;
+    header.cursor += sizeof( s_magic );
+    valid = valid && header.Read<quint32>() == s_version;
+    valid = valid && header.Read<quint64>() == static_cast<quint64>( json_info.size() );
+    valid = valid && header.Read<qint64>() == json_info.lastModified().toMSecsSinceEpoch();
+    valid = valid && header.Read<quint64>() == static_cast<quint64>( size - s_header_size );
+    valid = valid && header.Read<quint64>() == Checksum( mapped + s_header_size, size - s_header_size );
+    if( !valid ){
+        file.unmap( mapped );
+        return false;
+    }
+
+    Reader payload{ mapped + s_header_size, mapped + size, true };
+    QString const host = payload.ReadQString();
+    QStringList targets {};
+    quint32 const target_count = payload.Read<quint32>();
+    for( quint32 i = 0; payload.ok && i != target_count; ++i ) targets.append( payload.ReadQString() );
+    QMap<QString, Alias> loaded {};
+    QHash<QString, std::vector<DomainId>> wildcard_hosts {};
+    ReadAliases( payload, loaded, wildcard_hosts );
+    QMap<QString, Profile> profiles {};
+    quint32 const profile_count = payload.Read<quint32>();
+    for( quint32 i = 0; payload.ok && i != profile_count; ++i ){
+        QString const name = payload.ReadQString();
+        Profile &profile = profiles[name];
+        profile.fingerprint = payload.Read<quint64>();
+        ReadAliases( payload, profile.aliases, profile.wildcard_hosts );
+    }
+    bool const complete = payload.ok && payload.cursor == payload.end;
+    file.unmap( mapped );
+    if( !complete ) return false;
+
+    state.config_path = config_path;
+    state.hosts_file_path = host;
+    state.hosts_file_targets = targets;
+    state.aliases.swap( loaded );
+    state.wildcard_hosts.swap( wildcard_hosts );
+    state.profiles.swap( profiles );
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef CONFIG_SNAPSHOT_HPP
+#define CONFIG_SNAPSHOT_HPP
+
+#include <QMap>
+#include <QString>
+#include "config_writer.hpp"
+
+// A binary image of config.json kept next to it( config.json.snap ) so startup
+// can skip JSON parsing altogether. The snapshot is stamped with the size and
+// modification time of the JSON it was made from and carries a checksum of its
+// own payload; if any of them disagree the snapshot is ignored.
+class ConfigSnapshot
+{
+public:
+    static QString SnapshotPath( QString const & config_path );
+
+    // call right after `state.config_path` has been written
+    static bool Write( ConfigState const & state );
+    // memory-maps the snapshot; false when it is missing, stale or damaged, in which
+    // case `state` is left untouched and the caller should read the JSON instead
+    static bool Read( QString const & config_path, ConfigState & state );
+
+    static quint32 const s_version;
+};
+
+#endif // CONFIG_SNAPSHOT_HPP
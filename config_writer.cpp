@@ -0,0 +1,466 @@
+#include "config_writer.hpp"
+#include "config_journal.hpp"
+#include "config_snapshot.hpp"
+#include "json_stream_writer.hpp"
+#include "profile_cache.hpp"
+#include "statistics.hpp"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFuture>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSaveFile>
+#include <QSet>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrent>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+int const ConfigWriter::s_max_parallel_targets = 8;
+
+namespace {
+    // the "# Alias name:" line and every domain of an alias, rendered once per revision. The
+    // hosts file and the profile images each render their own revisions of the same names,
+    // so both are part of the key and neither evicts the other's blocks
+    using BlockKey = QPair<QString, quint64>;
+    QMutex                        s_block_mutex;
+    QHash<BlockKey, QByteArray>   s_blocks;
+
+    // drops the blocks of revisions neither the aliases nor any profile has any more
+    void PruneBlocks( ConfigState const & state )
+    {
+        int live = state.aliases.size();
+        for( auto const & profile: state.profiles ) live += profile.aliases.size();
+        QMutexLocker locker{ &s_block_mutex };
+        // fewer blocks than live aliases can't hold a dead one worth a pass over them
+        if( s_blocks.size() <= live ) return;
+        QSet<BlockKey> keep {};
+        keep.reserve( live );
+        for( auto const & alias: state.aliases ) keep.insert( qMakePair( alias.Name(), alias.Revision() ) );
+        for( auto const & profile: state.profiles ){
+            for( auto const & alias: profile.aliases ) keep.insert( qMakePair( alias.Name(), alias.Revision() ) );
+        }
+        for( auto iter = s_blocks.begin(); iter != s_blocks.end(); ){
+            if( !keep.contains( iter.key() ) ) iter = s_blocks.erase( iter );
+            else ++iter;
+        }
+    }
+
+    QByteArray RenderBlock( Alias const & alias )
+    {
+        DomainPool &pool = DomainPool::Global();
+        QByteArray const address = alias.Address().ToString().toUtf8();
+        QByteArray block {};
+        block.append( "# Alias name: " ).append( alias.Name().toUtf8() ).append( '\n' );
+        for( DomainId const id : alias.GetDomainNames() ){
+            block.append( '\t' ).append( address ).append( "\t\t" ).append( pool.Utf8( id ) ).append( '\n' );
+        }
+        return block;
+    }
+
+    // one writev() for the whole file where there is one, the buffers are never copied together
+    bool WriteGathered( QFileDevice & file, QVector<QByteArray> const & parts, qint64 & written, QString & error )
+    {
+        written = 0;
+#ifdef Q_OS_UNIX
+        std::vector<iovec> vectors {};
+        vectors.reserve( static_cast<std::size_t>( parts.size() ) );
+        for( auto const & part: parts ){
+            if( part.isEmpty() ) continue;
+            vectors.push_back( iovec{ const_cast<char *>( part.constData() ), static_cast<std::size_t>( part.size() ) } );
+        }
+        long const limit = ::sysconf( _SC_IOV_MAX );
+        std::size_t const max_vectors = limit > 0 ? static_cast<std::size_t>( limit ) : 16;
+        for( std::size_t next = 0; next < vectors.size(); ){
+            int const count = static_cast<int>( qMin( max_vectors, vectors.size() - next ) );
+            ssize_t done = ::writev( file.handle(), &vectors[next], count );
+            if( done < 0 ){
+                if( errno == EINTR ) continue;
+                error = qt_error_string( errno );
+                return false;
+            }
+            written += done;
+            // a short write can stop in the middle of a buffer
+            while( done > 0 ){
+                iovec &vector = vectors[next];
+                if( static_cast<std::size_t>( done ) >= vector.iov_len ){
+                    done -= static_cast<ssize_t>( vector.iov_len );
+                    ++next;
+                } else {
+                    vector.iov_base = static_cast<char *>( vector.iov_base ) + done;
+                    vector.iov_len -= static_cast<std::size_t>( done );
+                    done = 0;
+                }
+            }
+        }
+        return true;
+#else
+        for( auto const & part: parts ){
+            if( file.write( part ) != part.size() ){
+                error = file.errorString();
+                return false;
+            }
+            written += part.size();
+        }
+        return true;
+#endif
+    }
+
+    // the fan-out to hosts_file_targets is disk bound, a handful of writers in flight
+    // keeps the disk busy without a thread per target
+    class TargetPool : public QThreadPool
+    {
+    public:
+        TargetPool() { setMaxThreadCount( ConfigWriter::s_max_parallel_targets ); }
+    };
+
+    // temporary file, sync, rename: a reader of `path` sees the old image or the new one,
+    // and no two hosts files ever share the file they are written to
+    bool WriteTarget( QString const & path, QVector<QByteArray> const & parts, QString & error )
+    {
+        QSaveFile file{ path };
+        if( !file.open( QIODevice::WriteOnly | QIODevice::Unbuffered ) ){
+            error = file.errorString();
+            return false;
+        }
+        qint64 written = 0;
+        if( !WriteGathered( file, parts, written, error ) ) return false;
+        if( !file.commit() ){
+            error = file.errorString();
+            return false;
+        }
+        Statistics::Global().AddBytesWritten( Statistics::FileWrite, written );
+        return true;
+    }
+
+    void WriteAliases( JsonStreamWriter & json, QMap<QString, Alias> const & aliases,
+                       QHash<QString, std::vector<DomainId>> const & wildcard_hosts )
+    {
+        DomainPool &pool = DomainPool::Global();
+        // keys in the order QJsonObject sorts them, so the file looks as it always did
+        json.BeginArray();
+        for( auto const & alias: aliases ){
+            json.BeginObject();
+            json.Key( "ip" );
+            json.Value( alias.AddressText() );
+            json.Key( "name" );
+            json.Value( alias.Name() );
+            json.Key( "pointing_to" );
+            json.BeginArray();
+            for( DomainId const id: alias.GetDomainNames() ) json.Value( pool.Utf8( id ) );
+            json.EndArray();
+            if( !alias.Wildcards().isEmpty() ){
+                json.Key( "wildcards" );
+                json.BeginArray();
+                for( auto const & pattern: alias.Wildcards() ){
+                    json.BeginObject();
+                    json.Key( "hosts" );
+                    json.BeginArray();
+                    auto const known = wildcard_hosts.constFind( pattern );
+                    if( known != wildcard_hosts.cend() ){
+                        for( DomainId const id: known.value() ) json.Value( pool.Utf8( id ) );
+                    }
+                    json.EndArray();
+                    json.Key( "rule" );
+                    json.Value( pattern );
+                    json.EndObject();
+                }
+                json.EndArray();
+            }
+            json.EndObject();
+        }
+        json.EndArray();
+    }
+}
+
+ConfigWriter::ConfigWriter( QObject *parent ): QThread{ parent },
+    mutex{}, job_available{}, idle{}, jobs{}, last_job_id{ 0 }, writing{ false }, stopping{ false },
+    config_files_written{ 0 }, hosts_files_written{ 0 }
+{
+    qRegisterMetaType<quint64>( "quint64" );
+    start();
+}
+
+ConfigWriter::~ConfigWriter()
+{
+    Shutdown();
+}
+
+quint64 ConfigWriter::Enqueue( ConfigState const & state, int targets )
+{
+    QMutexLocker locker{ &mutex };
+    if( stopping ) return 0;
+    // a job that hasn't started yet would only write an older state, take it over
+    if( !jobs.empty() ){
+        Job &pending = jobs.back();
+        // a hosts-file-only state may carry an older generation than the one the pending
+        // job folds into config.json, keep the newer or the folded files outlive the write
+        quint64 const journal_generation = qMax( pending.state.journal_generation, state.journal_generation );
+        pending.targets |= targets;
+        pending.state = state;
+        pending.state.journal_generation = journal_generation;
+        return pending.id;
+    }
+    jobs.push_back( Job{ ++last_job_id, targets, state } );
+    job_available.wakeOne();
+    return last_job_id;
+}
+
+bool ConfigWriter::WaitForIdle( unsigned long timeout_ms )
+{
+    QElapsedTimer timer {};
+    timer.start();
+    QMutexLocker locker{ &mutex };
+    while( !jobs.empty() || writing ){
+        qint64 const left = static_cast<qint64>( timeout_ms ) - timer.elapsed();
+        if( left <= 0 || !idle.wait( &mutex, static_cast<unsigned long>( left ) ) ) return false;
+    }
+    return true;
+}
+
+void ConfigWriter::Shutdown()
+{
+    {
+        QMutexLocker locker{ &mutex };
+        stopping = true;
+        // only what hasn't started is dropped, the journal and the next start cover it
+        jobs.clear();
+        job_available.wakeOne();
+    }
+    wait();
+}
+
+void ConfigWriter::run()
+{
+    forever {
+        Job job {};
+        {
+            QMutexLocker locker{ &mutex };
+            while( jobs.empty() && !stopping ) job_available.wait( &mutex );
+            if( jobs.empty() ) return; // stopping and drained
+            job = std::move( jobs.front() );
+            jobs.pop_front();
+            writing = true;
+        }
+
+        QString error {};
+        bool ok = true;
+        if( job.targets & ConfigFile ){
+            ok = WriteConfigFile( job.state, error );
+            if( ok ) ++config_files_written;
+        }
+        if( ok && ( job.targets & HostsFile ) ){
+            ok = WriteHostsFile( job.state, error );
+            if( ok ) ++hosts_files_written;
+        }
+
+        if( ok ) emit JobFinished( job.id );
+        else emit JobFailed( job.id, error );
+
+        QMutexLocker locker{ &mutex };
+        writing = false;
+        if( jobs.empty() ) idle.wakeAll();
+    }
+}
+
+ConfigWriter::WriteCounts ConfigWriter::Written() const
+{
+    return WriteCounts{ config_files_written.loadAcquire(), hosts_files_written.loadAcquire() };
+}
+
+bool ConfigWriter::WriteConfigFile( ConfigState const & state, QString & error )
+{
+    QSaveFile config_file( state.config_path );
+    if( !config_file.open( QIODevice::WriteOnly ) ){
+        error = config_file.errorString();
+        return false;
+    }
+    qint64 bytes_written = 0;
+    {
+        // written as it is walked, never held in memory as a whole
+        ScopedTimer const timer{ Statistics::FileWrite };
+        JsonStreamWriter json{ config_file };
+        json.BeginObject();
+        json.Key( "aliases" );
+        WriteAliases( json, state.aliases, state.wildcard_hosts );
+        json.Key( "host" );
+        json.Value( state.hosts_file_path );
+        if( !state.profiles.isEmpty() ){
+            json.Key( "profiles" );
+            json.BeginArray();
+            for( auto iter = state.profiles.cbegin(); iter != state.profiles.cend(); ++iter ){
+                json.BeginObject();
+                json.Key( "aliases" );
+                WriteAliases( json, iter->aliases, iter->wildcard_hosts );
+                json.Key( "name" );
+                json.Value( iter.key() );
+                json.EndObject();
+            }
+            json.EndArray();
+        }
+        if( !state.hosts_file_targets.isEmpty() ){
+            json.Key( "targets" );
+            json.BeginArray();
+            for( auto const & target: state.hosts_file_targets ) json.Value( target );
+            json.EndArray();
+        }
+        json.EndObject();
+        bool const finished = json.Finish();
+        bytes_written = json.BytesWritten();
+        if( !finished || !config_file.commit() ){
+            error = config_file.errorString();
+            return false;
+        }
+    }
+    Statistics::Global().AddBytesWritten( Statistics::FileWrite, bytes_written );
+    ConfigSnapshot::Write( state );
+    // the journal is folded in, a crash before this only means replaying it once more
+    if( state.journal_generation != 0 ) ConfigJournal::Discard( state.config_path, state.journal_generation );
+    bool const refreshed = ProfileCache::Refresh( state, error );
+    PruneBlocks( state );
+    return refreshed;
+}
+
+QVector<QByteArray> ConfigWriter::RenderHostsFileParts( ConfigState const & state, QByteArray const & stamp )
+{
+    ScopedTimer const timer{ Statistics::HostsRender };
+    static QByteArray const default_strings = QByteArray( "# Copyright (c) 1993-2009 Microsoft Corp.\n#\n\
+# This is a sample HOSTS file used by Microsoft TCP/IP for Windows.\n\
+#\n\
+# This file contains the mappings of IP addresses to host names. Each\n\
+# entry should be kept on an individual line. The IP address should\n\
+# be placed in the first column followed by the corresponding host name.\n\
+# The IP address and the host name should be separated by at least one\n\
+# space.\n\
+#\n\
+# Additionally, comments (such as these) may be inserted on individual\n\
+# lines or following the machine name denoted by a '#' symbol.\n\
+#\n\
+# For example:\n\
+#\n\
+#      102.54.94.97     rhino.acme.com          # source server\n\
+#       38.25.63.10     x.acme.com              # x client host\n\
+\n\
+# localhost name resolution is handled within DNS itself.\n\
+#	127.0.0.1       localhost\n\
+#	::1             localhost" ) + "\n\n";
+    static QByteArray const block_end = "\n";
+
+    QVector<QByteArray> parts {};
+    parts.reserve( state.aliases.size() * 2 + 2 );
+    parts.append( default_strings );
+    parts.append( !stamp.isEmpty() ? stamp : "# Last sync date/time " + QDateTime::currentDateTime().toString().toUtf8() + "\n\n" );
+
+    // aliases sharing an address end up next to each other, in numeric address order
+    std::vector<Alias const *> ordered {};
+    ordered.reserve( static_cast<std::size_t>( state.aliases.size() ) );
+    for( auto const & alias: state.aliases ) ordered.push_back( &alias );
+    std::stable_sort( ordered.begin(), ordered.end(), []( Alias const * a, Alias const * b ){
+        return a->Address() < b->Address();
+    });
+
+    DomainPool &pool = DomainPool::Global();
+    qint64 entries = 0;
+    QMutexLocker locker{ &s_block_mutex };
+    for( Alias const *entry: ordered ){
+        Alias const & alias = *entry;
+        // config.json keeps an unusable address as written, the hosts file can't have it
+        if( !alias.HasAddress() || ( alias.IsEmptyDomain() && alias.Wildcards().isEmpty() ) ) continue;
+
+        QByteArray &block = s_blocks[qMakePair( alias.Name(), alias.Revision() )];
+        if( block.isEmpty() ) block = RenderBlock( alias );
+        parts.append( block );
+        entries += static_cast<qint64>( alias.GetDomainNames().size() );
+
+        // rules are rendered every time, the hosts they own change without the alias changing
+        if( alias.Wildcards().isEmpty() ){
+            parts.append( block_end );
+            continue;
+        }
+        QByteArray const address = alias.Address().ToString().toUtf8();
+        QByteArray rules {};
+        // hosts files know nothing about wildcards, spell out every host the rule owns
+        for( auto const & pattern: alias.Wildcards() ){
+            rules.append( "# Rule: " ).append( pattern.toUtf8() ).append( '\n' );
+            auto const hosts = state.wildcard_hosts.constFind( pattern );
+            if( hosts == state.wildcard_hosts.cend() ) continue;
+            for( DomainId const id : hosts.value() ){
+                rules.append( '\t' ).append( address ).append( "\t\t" ).append( pool.Utf8( id ) ).append( '\n' );
+            }
+            entries += static_cast<qint64>( hosts->size() );
+        }
+        parts.append( rules.append( block_end ) );
+    }
+    Statistics::Global().AddEntries( Statistics::HostsRender, entries );
+    return parts;
+}
+
+QByteArray ConfigWriter::RenderHostsFile( ConfigState const & state )
+{
+    QVector<QByteArray> const parts = RenderHostsFileParts( state );
+    int size = 0;
+    for( auto const & part: parts ) size += part.size();
+    QByteArray image {};
+    image.reserve( size );
+    for( auto const & part: parts ) image.append( part );
+    return image;
+}
+
+bool ConfigWriter::WriteHostsFile( ConfigState const & state, QString & error )
+{
+    auto const profile = state.profiles.constFind( state.active_profile );
+    bool const swap_image = profile != state.profiles.cend() &&
+            ProfileCache::IsCurrent( state.config_path, profile.key(), profile.value() );
+    // rendered once, the parts are only ever read from here on, by every target's writer
+    QVector<QByteArray> const parts = swap_image ? QVector<QByteArray>{} : RenderHostsFileParts( state );
+    PruneBlocks( state );
+    // a switch renames the copy staged next to each target over it
+    auto const write = [&state, &parts, swap_image, profile]( QString const & target, QString & target_error ){
+        return swap_image ? ProfileCache::Swap( state.config_path, profile.key(), profile.value(), target, target_error )
+                          : WriteTarget( target, parts, target_error );
+    };
+
+    static TargetPool s_pool {};
+    QVector<QPair<QString, QFuture<QString>>> writes {};
+    for( auto const & target: state.hosts_file_targets ){
+        writes.append( qMakePair( target, QtConcurrent::run( &s_pool, [target, &write]{
+            ScopedTimer const timer{ Statistics::FileWrite };
+            QString target_error {};
+            return write( target, target_error ) ? QString{} : target_error;
+        })));
+    }
+
+    // the main hosts file is replaced the same way, on this thread while the targets are in flight
+    QString main_error {};
+    bool main_ok = true;
+    {
+        ScopedTimer const timer{ Statistics::FileWrite };
+        main_ok = write( state.hosts_file_path, main_error );
+    }
+    for( auto & pending: writes ) pending.second.waitForFinished();
+    // the renames used up the staged copies, put them back before the next switch needs them.
+    // The hosts files are already switched, a copy that can't be staged is made by that switch
+    QString stage_error {};
+    if( swap_image && !ProfileCache::Stage( state, stage_error ) ) qWarning() << "Unable to stage the profile images:" << stage_error;
+    if( writes.isEmpty() ){
+        error = main_error;
+        return main_ok;
+    }
+    QStringList failures {};
+    if( !main_ok ) failures.append( state.hosts_file_path + ": " + main_error );
+    for( auto & pending: writes ){
+        QString const target_error = pending.second.result();
+        if( !target_error.isEmpty() ) failures.append( pending.first + ": " + target_error );
+    }
+    error = failures.join( '\n' );
+    return failures.isEmpty();
+}
@@ -0,0 +1,120 @@
+#ifndef CONFIG_WRITER_HPP
+#define CONFIG_WRITER_HPP
+
+#include <QAtomicInteger>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <deque>
+
+#include "alias.hpp"
+
+// a saved set of every alias' domains and rules( "local", "staging", ... ), switched
+// to as a whole. Its hosts file image is rendered ahead of time, see ProfileCache
+struct Profile
+{
+    QMap<QString, Alias>                   aliases;
+    QHash<QString, std::vector<DomainId>>  wildcard_hosts;
+    quint64                                fingerprint; // of the above, tells a stale image apart
+};
+
+// everything a write needs. QMap is implicitly shared, so taking one of these
+// is cheap and the GUI is free to keep mutating its own copy afterwards
+struct ConfigState
+{
+    QString               config_path;
+    QString               hosts_file_path;
+    QMap<QString, Alias>  aliases;
+    // wildcard rule -> the known hosts it owns, expanded when the state is taken
+    QHash<QString, std::vector<DomainId>> wildcard_hosts;
+    QMap<QString, Profile> profiles;
+    // set while the aliases are exactly this profile's, the hosts file is then swapped
+    // for its image instead of being rendered
+    QString               active_profile;
+    // the newest ConfigJournal generation this state includes, its files are removed
+    // once config.json is written. 0 when there is none
+    quint64               journal_generation;
+    // more hosts files( containers, chroots ) that get the same image as hosts_file_path
+    QStringList           hosts_file_targets;
+};
+
+// Owns a thread that writes config.json( and its snapshot ) and the hosts file
+// from queued ConfigStates, so the GUI never blocks on disk I/O. Results come back
+// through JobFinished/JobFailed, delivered on the thread that owns the writer.
+class ConfigWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum Target {
+        ConfigFile = 0x1,
+        HostsFile  = 0x2,
+        AllFiles   = ConfigFile | HostsFile
+    };
+
+    // files the writer thread has actually written, counted once each job is done
+    struct WriteCounts {
+        quint64 config_files;
+        quint64 hosts_files;
+    };
+
+    explicit ConfigWriter( QObject *parent = nullptr );
+    ~ConfigWriter();
+
+    // returns the job's id, 0 once shutdown has started. A job still waiting in the queue
+    // absorbs newer ones, so the id may be one handed out before
+    quint64 Enqueue( ConfigState const & state, int targets );
+    // waits at most `timeout_ms` for the queue to run dry and the last job to finish.
+    // Returns false if writes were still pending when it gave up
+    bool    WaitForIdle( unsigned long timeout_ms );
+    // stops accepting jobs, drops the queued ones and waits for the one being written, however
+    // long it takes: a write is never cut short
+    void    Shutdown();
+    // any thread
+    WriteCounts Written() const;
+
+    // the actual writers, usable from any thread. Writing config.json also brings the
+    // profile images up to date
+    static bool WriteConfigFile( ConfigState const & state, QString & error );
+    // the image is rendered once and also written to every one of hosts_file_targets, at
+    // most s_max_parallel_targets at a time, each replaced in one rename. A target that
+    // fails doesn't stop the others, `error` then has a line per failed one
+    static bool WriteHostsFile( ConfigState const & state, QString & error );
+    // the file in pieces: unchanged aliases reuse the block rendered for their revision,
+    // so a sync only formats what changed. `stamp` replaces the "# Last sync" line
+    static QVector<QByteArray> RenderHostsFileParts( ConfigState const & state, QByteArray const & stamp = QByteArray{} );
+    static QByteArray RenderHostsFile( ConfigState const & state );
+
+    static int const s_max_parallel_targets;
+
+signals:
+    void JobFinished( quint64 job_id );
+    void JobFailed( quint64 job_id, QString const & error );
+
+protected:
+    void run() override;
+
+private:
+    struct Job {
+        quint64     id;
+        int         targets;
+        ConfigState state;
+    };
+
+    QMutex           mutex;
+    QWaitCondition   job_available;
+    QWaitCondition   idle;
+    std::deque<Job>  jobs;
+    quint64          last_job_id;
+    bool             writing;
+    bool             stopping;
+    QAtomicInteger<quint64> config_files_written;
+    QAtomicInteger<quint64> hosts_files_written;
+};
+
+#endif // CONFIG_WRITER_HPP
@@ -0,0 +1,45 @@
+# The GUI-free part of the application: parsing, the alias model, the
+# config/hosts file I/O and the DNS responder. Shared by the application and
+# the benchmarks, which need QT += concurrent network.
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/alias.cpp \
+    $$PWD/alias_snapshot.cpp \
+    $$PWD/hosts_parser.cpp \
+    $$PWD/hosts_scanner.cpp \
+    $$PWD/domain_pool.cpp \
+    $$PWD/config_snapshot.cpp \
+    $$PWD/config_journal.cpp \
+    $$PWD/config_writer.cpp \
+    $$PWD/alias_store.cpp \
+    $$PWD/domain_trie.cpp \
+    $$PWD/ip_address.cpp \
+    $$PWD/profile_cache.cpp \
+    $$PWD/json_stream_writer.cpp \
+    $$PWD/blocklist_importer.cpp \
+    $$PWD/search_index.cpp \
+    $$PWD/dns_table.cpp \
+    $$PWD/dns_responder.cpp \
+    $$PWD/statistics.cpp
+
+HEADERS += \
+    $$PWD/alias.hpp \
+    $$PWD/alias_snapshot.hpp \
+    $$PWD/hosts_parser.hpp \
+    $$PWD/hosts_scanner.hpp \
+    $$PWD/domain_pool.hpp \
+    $$PWD/config_snapshot.hpp \
+    $$PWD/config_journal.hpp \
+    $$PWD/config_writer.hpp \
+    $$PWD/alias_store.hpp \
+    $$PWD/domain_trie.hpp \
+    $$PWD/ip_address.hpp \
+    $$PWD/profile_cache.hpp \
+    $$PWD/json_stream_writer.hpp \
+    $$PWD/blocklist_importer.hpp \
+    $$PWD/search_index.hpp \
+    $$PWD/dns_table.hpp \
+    $$PWD/dns_responder.hpp \
+    $$PWD/statistics.hpp
@@ -0,0 +1,404 @@
+#include "dns_responder.hpp"
+#include "statistics.hpp"
+#include <QDateTime>
+#include <QHash>
+#include <QHostAddress>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QtEndian>
+
+namespace {
+    int const     s_header_size = 12;
+    int const     s_max_name_length = 255;
+    quint16 const s_type_a = 1;
+    quint16 const s_type_aaaa = 28;
+    quint16 const s_type_any = 255;
+    quint16 const s_class_in = 1;
+    quint16 const s_class_any = 255;
+
+    enum ResponseCode : quint16 {
+        NoError        = 0,
+        FormatError    = 1,
+        NameError      = 3, // NXDOMAIN
+        NotImplemented = 4,
+        Refused        = 5
+    };
+
+    // a relayed query nobody answered is forgotten after this, the client retries by itself
+    qint64 const s_forward_timeout_ms = 5000;
+
+    void AppendBigEndian16( QByteArray & buffer, quint16 value )
+    {
+        uchar bytes[2];
+        qToBigEndian<quint16>( value, bytes );
+        buffer.append( reinterpret_cast<char const *>( bytes ), 2 );
+    }
+
+    void AppendBigEndian32( QByteArray & buffer, quint32 value )
+    {
+        uchar bytes[4];
+        qToBigEndian<quint32>( value, bytes );
+        buffer.append( reinterpret_cast<char const *>( bytes ), 4 );
+    }
+
+    bool ParseUpstream( QString const & text, QHostAddress & address, quint16 & port )
+    {
+        QString host = text.trimmed();
+        port = 53;
+        int const colon = host.lastIndexOf( ':' );
+        // a bare IPv6 address has colons too, a port after one has to be bracketed
+        bool const bracketed = host.startsWith( '[' );
+        if( colon > 0 && ( bracketed || host.indexOf( ':' ) == colon ) ){
+            bool valid = false;
+            port = static_cast<quint16>( host.mid( colon + 1 ).toUShort( &valid ) );
+            if( !valid || port == 0 ) return false;
+            host.truncate( colon );
+        }
+        if( bracketed ) host = host.mid( 1, host.size() - 2 );
+        return address.setAddress( host );
+    }
+}
+
+quint16 const DnsResponder::s_default_port = 53535;
+quint32 const DnsResponder::s_ttl = 5;
+
+// Owns the sockets; created, used and destroyed on DnsResponder::thread.
+class DnsResponder::Worker : public QObject
+{
+public:
+    explicit Worker( DnsResponder & responder );
+
+    bool Open( quint16 port, QHostAddress const & upstream, quint16 upstream_port, QString & error );
+private:
+    struct PendingForward {
+        quint16              client_id;
+        QHostAddress         client_address;
+        quint16              client_port;
+        QPointer<QTcpSocket> tcp_client; // set for queries that came in over TCP
+        qint64               sent_ms;
+    };
+
+    void OnUdpReadyRead();
+    void OnUpstreamReadyRead();
+    void OnNewTcpConnection();
+    void OnTcpReadyRead( QTcpSocket *socket );
+    void ExpireForwards();
+    // answers or relays one query; `reply_to` sends a reply back the way the query came
+    template<typename ReplyTo>
+    void Handle( char const * query, int size, PendingForward const & origin, ReplyTo && reply_to );
+    static void WriteTcpReply( QTcpSocket *socket, QByteArray const & reply );
+
+    DnsResponder                  &responder;
+    QUdpSocket                    *udp;
+    QTcpServer                    *tcp;
+    QUdpSocket                    *upstream_socket;
+    QHostAddress                  upstream;
+    quint16                       upstream_port;
+    QHash<quint16, PendingForward> pending;
+    quint16                       next_forward_id;
+    QHash<QTcpSocket *, QByteArray> tcp_buffers;
+    QByteArray                    datagram;
+};
+
+DnsResponder::Worker::Worker( DnsResponder & responder_ ): QObject{ nullptr }, responder{ responder_ },
+    udp{ nullptr }, tcp{ nullptr }, upstream_socket{ nullptr }, upstream{}, upstream_port{ 0 }, pending{},
+    next_forward_id{ 0 }, tcp_buffers{}, datagram( 65536, '\0' )
+{
+}
+
+bool DnsResponder::Worker::Open( quint16 port, QHostAddress const & upstream_, quint16 upstream_port_, QString & error )
+{
+    udp = new QUdpSocket( this );
+    if( !udp->bind( QHostAddress::LocalHost, port ) ){
+        error = udp->errorString();
+        return false;
+    }
+    tcp = new QTcpServer( this );
+    if( !tcp->listen( QHostAddress::LocalHost, udp->localPort() ) ){
+        error = tcp->errorString();
+        return false;
+    }
+    responder.port = udp->localPort();
+    QObject::connect( udp, &QUdpSocket::readyRead, this, [this]{ OnUdpReadyRead(); } );
+    QObject::connect( tcp, &QTcpServer::newConnection, this, [this]{ OnNewTcpConnection(); } );
+
+    upstream = upstream_;
+    upstream_port = upstream_port_;
+    if( !upstream.isNull() ){
+        upstream_socket = new QUdpSocket( this );
+        if( !upstream_socket->bind( upstream.protocol() == QAbstractSocket::IPv6Protocol ?
+                                    QHostAddress::AnyIPv6 : QHostAddress::AnyIPv4, 0 ) ){
+            error = upstream_socket->errorString();
+            return false;
+        }
+        QObject::connect( upstream_socket, &QUdpSocket::readyRead, this, [this]{ OnUpstreamReadyRead(); } );
+        QTimer *expiry = new QTimer( this );
+        QObject::connect( expiry, &QTimer::timeout, this, [this]{ ExpireForwards(); } );
+        expiry->start( 1000 );
+    }
+    return true;
+}
+
+template<typename ReplyTo>
+void DnsResponder::Worker::Handle( char const * query, int size, PendingForward const & origin, ReplyTo && reply_to )
+{
+    ScopedTimer const timer{ Statistics::DnsQuery };
+    responder.queries.fetch_add( 1, std::memory_order_relaxed );
+
+    QByteArray reply {};
+    Verdict const verdict = DnsResponder::Answer( query, size, responder.table, upstream_socket != nullptr, reply );
+    if( verdict == Verdict::Drop ){
+        responder.failed.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+    if( verdict == Verdict::Reply ){
+        switch( static_cast<uchar>( reply[3] ) & 0x0F ){
+        case NoError:   responder.answered.fetch_add( 1, std::memory_order_relaxed ); break;
+        case NameError: responder.nxdomain.fetch_add( 1, std::memory_order_relaxed ); break;
+        default:        responder.failed.fetch_add( 1, std::memory_order_relaxed ); break;
+        }
+        reply_to( reply );
+        return;
+    }
+
+    // every id is taken, the client will ask again
+    if( pending.size() > 0xFFFF ) return;
+    // relayed under an id of our own, two clients may well have picked the same one
+    quint16 id = next_forward_id++;
+    while( pending.contains( id ) ) id = next_forward_id++;
+    PendingForward forward = origin;
+    forward.client_id = qFromBigEndian<quint16>( reinterpret_cast<uchar const *>( query ) );
+    forward.sent_ms = QDateTime::currentMSecsSinceEpoch();
+    pending.insert( id, forward );
+
+    QByteArray relayed( query, size );
+    qToBigEndian<quint16>( id, reinterpret_cast<uchar *>( relayed.data() ) );
+    upstream_socket->writeDatagram( relayed, upstream, upstream_port );
+    responder.forwarded.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void DnsResponder::Worker::OnUdpReadyRead()
+{
+    while( udp->hasPendingDatagrams() ){
+        QHostAddress sender {};
+        quint16 sender_port = 0;
+        qint64 const size = udp->readDatagram( datagram.data(), datagram.size(), &sender, &sender_port );
+        if( size <= 0 ) continue;
+        PendingForward const origin{ 0, sender, sender_port, nullptr, 0 };
+        Handle( datagram.constData(), static_cast<int>( size ), origin, [&]( QByteArray const & reply ){
+            udp->writeDatagram( reply, sender, sender_port );
+        });
+    }
+}
+
+void DnsResponder::Worker::OnUpstreamReadyRead()
+{
+    while( upstream_socket->hasPendingDatagrams() ){
+        QHostAddress sender {};
+        quint16 sender_port = 0;
+        qint64 const size = upstream_socket->readDatagram( datagram.data(), datagram.size(), &sender, &sender_port );
+        if( size < s_header_size || sender_port != upstream_port || !sender.isEqual( upstream, QHostAddress::TolerantConversion ) ){
+            continue;
+        }
+        uchar *bytes = reinterpret_cast<uchar *>( datagram.data() );
+        auto const forward = pending.find( qFromBigEndian<quint16>( bytes ) );
+        if( forward == pending.end() ) continue;
+
+        qToBigEndian<quint16>( forward->client_id, bytes );
+        QByteArray const reply( datagram.constData(), static_cast<int>( size ) );
+        if( !forward->tcp_client.isNull() ) WriteTcpReply( forward->tcp_client.data(), reply );
+        else if( forward->client_port != 0 ) udp->writeDatagram( reply, forward->client_address, forward->client_port );
+        pending.erase( forward );
+    }
+}
+
+void DnsResponder::Worker::OnNewTcpConnection()
+{
+    while( QTcpSocket *socket = tcp->nextPendingConnection() ){
+        tcp_buffers.insert( socket, QByteArray{} );
+        QObject::connect( socket, &QTcpSocket::readyRead, this, [this, socket]{ OnTcpReadyRead( socket ); } );
+        QObject::connect( socket, &QTcpSocket::disconnected, this, [this, socket]{
+            tcp_buffers.remove( socket );
+            socket->deleteLater();
+        });
+    }
+}
+
+void DnsResponder::Worker::OnTcpReadyRead( QTcpSocket *socket )
+{
+    QByteArray &buffer = tcp_buffers[socket];
+    buffer.append( socket->readAll() );
+    // every message is preceded by its length, several may arrive at once
+    int offset = 0;
+    while( buffer.size() - offset >= 2 ){
+        int const size = qFromBigEndian<quint16>( reinterpret_cast<uchar const *>( buffer.constData() + offset ) );
+        if( buffer.size() - offset - 2 < size ) break;
+        PendingForward const origin{ 0, QHostAddress{}, 0, socket, 0 };
+        Handle( buffer.constData() + offset + 2, size, origin, [socket]( QByteArray const & reply ){
+            WriteTcpReply( socket, reply );
+        });
+        offset += 2 + size;
+    }
+    buffer.remove( 0, offset );
+}
+
+void DnsResponder::Worker::WriteTcpReply( QTcpSocket *socket, QByteArray const & reply )
+{
+    QByteArray framed {};
+    framed.reserve( reply.size() + 2 );
+    AppendBigEndian16( framed, static_cast<quint16>( reply.size() ) );
+    framed.append( reply );
+    socket->write( framed );
+}
+
+void DnsResponder::Worker::ExpireForwards()
+{
+    qint64 const now = QDateTime::currentMSecsSinceEpoch();
+    for( auto iter = pending.begin(); iter != pending.end(); ){
+        if( now - iter->sent_ms > s_forward_timeout_ms ) iter = pending.erase( iter );
+        else ++iter;
+    }
+}
+
+DnsResponder::DnsResponder( DnsTable const & table_ ): table{ table_ }, thread{}, worker{ nullptr }, port{ 0 },
+    queries{ 0 }, answered{ 0 }, nxdomain{ 0 }, forwarded{ 0 }, failed{ 0 }
+{
+    thread.setObjectName( "dns responder" );
+}
+
+DnsResponder::~DnsResponder()
+{
+    Stop();
+}
+
+bool DnsResponder::Start( quint16 port_, QString const & upstream, QString & error )
+{
+    Stop();
+    QHostAddress upstream_address {};
+    quint16 upstream_port = 0;
+    if( !upstream.trimmed().isEmpty() && !ParseUpstream( upstream, upstream_address, upstream_port ) ){
+        error = QString( "'%1' is not an address or address:port" ).arg( upstream );
+        return false;
+    }
+
+    thread.start();
+    worker = new Worker( *this );
+    worker->moveToThread( &thread );
+    bool opened = false;
+    QMetaObject::invokeMethod( worker, [&]{
+        opened = worker->Open( port_, upstream_address, upstream_port, error );
+    }, Qt::BlockingQueuedConnection );
+    if( !opened ) Stop();
+    return opened;
+}
+
+void DnsResponder::Stop()
+{
+    if( !thread.isRunning() ) return;
+    // deferred deletes still run as the thread finishes, so the sockets go on their own thread
+    if( worker ) worker->deleteLater();
+    worker = nullptr;
+    thread.quit();
+    thread.wait();
+    port = 0;
+}
+
+bool DnsResponder::IsRunning() const
+{
+    return worker != nullptr;
+}
+
+quint16 DnsResponder::Port() const
+{
+    return port;
+}
+
+DnsResponder::Counters DnsResponder::GetCounters() const
+{
+    return Counters{ queries.load( std::memory_order_relaxed ), answered.load( std::memory_order_relaxed ),
+                     nxdomain.load( std::memory_order_relaxed ), forwarded.load( std::memory_order_relaxed ),
+                     failed.load( std::memory_order_relaxed ) };
+}
+
+DnsResponder::Verdict DnsResponder::Answer( char const * query, int size, DnsTable const & table, bool can_forward,
+                                            QByteArray & reply )
+{
+    uchar const *bytes = reinterpret_cast<uchar const *>( query );
+    if( size < s_header_size ) return Verdict::Drop;
+    quint16 const flags = qFromBigEndian<quint16>( bytes + 2 );
+    if( flags & 0x8000 ) return Verdict::Drop; // a response, not a query
+
+    // the header is echoed back, flags as they apply to us
+    auto respond = [&]( quint16 rcode, int question_end, quint16 answers ){
+        reply.clear();
+        reply.reserve( question_end + 16 + 28 );
+        reply.append( query, 2 ); // id
+        quint16 const reply_flags = 0x8000 | 0x0400 /* authoritative */ | ( flags & 0x0100 ) /* recursion desired */ |
+                ( can_forward ? 0x0080 : 0 ) /* recursion available */ | rcode;
+        AppendBigEndian16( reply, reply_flags );
+        AppendBigEndian16( reply, question_end > s_header_size ? 1 : 0 );
+        AppendBigEndian16( reply, answers );
+        AppendBigEndian16( reply, 0 );
+        AppendBigEndian16( reply, 0 ); // an EDNS record in the query isn't echoed, plain DNS is fine
+        reply.append( query + s_header_size, question_end - s_header_size );
+        return Verdict::Reply;
+    };
+
+    if( ( ( flags >> 11 ) & 0x0F ) != 0 ) return respond( NotImplemented, s_header_size, 0 ); // only QUERY
+    if( qFromBigEndian<quint16>( bytes + 4 ) != 1 ) return respond( FormatError, s_header_size, 0 );
+
+    // the question name, lowercased into dotted form. Queries carry no compression pointers
+    char name[s_max_name_length + 1];
+    int name_length = 0;
+    int position = s_header_size;
+    for( ;; ){
+        if( position >= size ) return respond( FormatError, s_header_size, 0 );
+        int const label_length = bytes[position++];
+        if( label_length == 0 ) break;
+        if( ( label_length & 0xC0 ) != 0 || position + label_length > size ||
+                name_length + label_length + 1 > s_max_name_length ){
+            return respond( FormatError, s_header_size, 0 );
+        }
+        if( name_length != 0 ) name[name_length++] = '.';
+        for( int i = 0; i != label_length; ++i ){
+            char const c = query[position + i];
+            name[name_length++] = c >= 'A' && c <= 'Z' ? static_cast<char>( c + ( 'a' - 'A' ) ) : c;
+        }
+        position += label_length;
+    }
+    if( position + 4 > size ) return respond( FormatError, s_header_size, 0 );
+    quint16 const type = qFromBigEndian<quint16>( bytes + position );
+    quint16 const klass = qFromBigEndian<quint16>( bytes + position + 2 );
+    int const question_end = position + 4;
+    if( klass != s_class_in && klass != s_class_any ) return respond( Refused, question_end, 0 );
+
+    IpAddress address {};
+    if( !table.Lookup( name, name_length, address ) ){
+        if( can_forward ) return Verdict::Forward;
+        return respond( NameError, question_end, 0 );
+    }
+    // a known name without a record of the asked type is NOERROR with no answers
+    bool const v4 = address.IsV4();
+    bool const matches = type == s_type_any || ( type == s_type_a && v4 ) || ( type == s_type_aaaa && !v4 );
+    respond( NoError, question_end, matches ? 1 : 0 );
+    if( !matches ) return Verdict::Reply;
+
+    AppendBigEndian16( reply, 0xC000 | s_header_size ); // the name, pointing back at the question
+    AppendBigEndian16( reply, v4 ? s_type_a : s_type_aaaa );
+    AppendBigEndian16( reply, s_class_in );
+    AppendBigEndian32( reply, s_ttl );
+    if( v4 ){
+        AppendBigEndian16( reply, 4 );
+        AppendBigEndian32( reply, static_cast<quint32>( address.Low() ) );
+    } else {
+        AppendBigEndian16( reply, 16 );
+        AppendBigEndian32( reply, static_cast<quint32>( address.High() >> 32 ) );
+        AppendBigEndian32( reply, static_cast<quint32>( address.High() ) );
+        AppendBigEndian32( reply, static_cast<quint32>( address.Low() >> 32 ) );
+        AppendBigEndian32( reply, static_cast<quint32>( address.Low() ) );
+    }
+    return Verdict::Reply;
+}
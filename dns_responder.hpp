@@ -0,0 +1,70 @@
+#ifndef DNS_RESPONDER_HPP
+#define DNS_RESPONDER_HPP
+
+#include <QByteArray>
+#include <QString>
+#include <QThread>
+#include <atomic>
+
+#include "dns_table.hpp"
+
+// A minimal DNS server on 127.0.0.1, UDP and TCP on the same port, answering A and AAAA
+// queries straight from a DnsTable so a repoint is visible to the next query, with no
+// hosts file rewrite in between. Names the table doesn't know are relayed to an upstream
+// server when one is set and get NXDOMAIN otherwise. Sockets live on a thread of their
+// own, the GUI only ever touches the table.
+//
+//   dig @127.0.0.1 -p 53535 www.example.com A
+class DnsResponder
+{
+public:
+    enum class Verdict {
+        Reply,   // `reply` holds the answer
+        Forward, // unknown name and there is an upstream to ask
+        Drop     // not something to answer at all, e.g. too short to hold a header
+    };
+
+    struct Counters {
+        quint64 queries;
+        quint64 answered;  // from the table, including "no record of that type"
+        quint64 nxdomain;
+        quint64 forwarded;
+        quint64 failed;    // malformed, refused or not implemented
+    };
+
+    explicit DnsResponder( DnsTable const & table );
+    ~DnsResponder();
+
+    // `upstream` is "address" or "address:port"( "[v6 address]:port" ), empty for none
+    bool     Start( quint16 port, QString const & upstream, QString & error );
+    void     Stop();
+    bool     IsRunning() const;
+    quint16  Port() const;
+    Counters GetCounters() const;
+
+    // the wire format half, no sockets involved: what to do with `query` and the reply
+    // when there is one. `can_forward` decides between Forward and NXDOMAIN
+    static Verdict Answer( char const * query, int size, DnsTable const & table, bool can_forward,
+                           QByteArray & reply );
+
+    static quint16 const s_default_port;
+    // short, a repoint should not outlive a resolver's cache for long
+    static quint32 const s_ttl;
+private:
+    class Worker;
+
+    DnsResponder( DnsResponder const & ) = delete;
+    DnsResponder & operator=( DnsResponder const & ) = delete;
+
+    DnsTable const &       table;
+    QThread                thread;
+    Worker                 *worker;
+    quint16                port;
+    std::atomic<quint64>   queries;
+    std::atomic<quint64>   answered;
+    std::atomic<quint64>   nxdomain;
+    std::atomic<quint64>   forwarded;
+    std::atomic<quint64>   failed;
+};
+
+#endif // DNS_RESPONDER_HPP
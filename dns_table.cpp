@@ -0,0 +1,115 @@
+#include "dns_table.hpp"
+#include <QPair>
+#include <QVector>
+#include <algorithm>
+#include <iterator>
+
+DnsTable::DnsTable(): lock{}, hosts{}, rules{}, synced{}, synced_version{ 0 }
+{
+}
+
+QByteArray DnsTable::Key( QString const & name )
+{
+    return name.toLower().toUtf8();
+}
+
+void DnsTable::Sync( AliasSnapshotPtr const & snapshot )
+{
+    if( snapshot->version == synced_version ) return;
+    synced_version = snapshot->version;
+    QMap<QString, AliasSnapshot::AliasPtr> const & aliases = snapshot->aliases;
+    DomainPool const &pool = DomainPool::Global();
+    std::vector<DomainId> removed_hosts {};
+    QStringList removed_rules {};
+    QVector<QPair<DomainId, IpAddress>> added_hosts {};
+    QVector<QPair<QString, IpAddress>> added_rules {};
+
+    // an alias without a usable address answers nothing, as if it weren't there
+    for( auto iter = synced.begin(); iter != synced.end(); ){
+        auto const alias = aliases.constFind( iter.key() );
+        if( alias != aliases.cend() && ( *alias )->HasAddress() ){
+            ++iter;
+            continue;
+        }
+        removed_hosts.insert( removed_hosts.end(), iter->domains.cbegin(), iter->domains.cend() );
+        removed_rules.append( iter->wildcards );
+        iter = synced.erase( iter );
+    }
+
+    for( auto const & node: aliases ){
+        Alias const & alias = *node;
+        if( !alias.HasAddress() ) continue;
+        auto previous = synced.find( alias.Name() );
+        if( previous != synced.end() && previous->revision == alias.Revision() &&
+                previous->address == alias.Address() ){
+            continue;
+        }
+        std::vector<DomainId> const & domains = alias.GetDomainNames();
+        if( previous == synced.end() ){
+            previous = synced.insert( alias.Name(), SyncedAlias{ 0, alias.Address(), {}, {} } );
+        }
+        // both lists are sorted; with the address unchanged only the difference is touched
+        bool const moved = previous->address != alias.Address();
+        std::set_difference( previous->domains.cbegin(), previous->domains.cend(), domains.cbegin(), domains.cend(),
+                             std::back_inserter( removed_hosts ) );
+        std::vector<DomainId> new_domains {};
+        if( moved ){
+            new_domains = domains;
+        } else {
+            std::set_difference( domains.cbegin(), domains.cend(), previous->domains.cbegin(), previous->domains.cend(),
+                                 std::back_inserter( new_domains ) );
+        }
+        for( DomainId const id: new_domains ) added_hosts.append( qMakePair( id, alias.Address() ) );
+        for( auto const & pattern: previous->wildcards ){
+            if( !alias.Wildcards().contains( pattern ) ) removed_rules.append( pattern );
+        }
+        for( auto const & pattern: alias.Wildcards() ){
+            if( moved || !previous->wildcards.contains( pattern ) ) added_rules.append( qMakePair( pattern, alias.Address() ) );
+        }
+        *previous = SyncedAlias{ alias.Revision(), alias.Address(), domains, alias.Wildcards() };
+    }
+    if( removed_hosts.empty() && removed_rules.isEmpty() && added_hosts.isEmpty() && added_rules.isEmpty() ) return;
+
+    // names are looked up before taking the lock, readers only wait for the hash updates
+    QVector<QByteArray> removed_keys {}, added_keys {};
+    removed_keys.reserve( static_cast<int>( removed_hosts.size() ) );
+    for( DomainId const id: removed_hosts ) removed_keys.append( pool.Utf8( id ).toLower() );
+    added_keys.reserve( added_hosts.size() );
+    for( auto const & host: added_hosts ) added_keys.append( pool.Utf8( host.first ).toLower() );
+
+    QWriteLocker locker{ &lock };
+    // removals first: a name that moved between two aliases leaves one and joins the other
+    for( auto const & key: removed_keys ) hosts.remove( key );
+    // "*." is two characters
+    for( auto const & pattern: removed_rules ) rules.remove( Key( pattern.mid( 2 ) ) );
+    for( int i = 0; i != added_keys.size(); ++i ) hosts.insert( added_keys[i], added_hosts[i].second );
+    for( auto const & rule: added_rules ) rules.insert( Key( rule.first.mid( 2 ) ), rule.second );
+}
+
+bool DnsTable::Lookup( char const * name, int length, IpAddress & address ) const
+{
+    QReadLocker locker{ &lock };
+    auto const host = hosts.constFind( QByteArray::fromRawData( name, length ) );
+    if( host != hosts.cend() ){
+        address = host.value();
+        return true;
+    }
+    if( rules.isEmpty() ) return false;
+    // "a.b.staging.corp" tries "b.staging.corp", then "staging.corp", then "corp": a rule
+    // covers the names strictly below it
+    for( int i = 0; i != length; ++i ){
+        if( name[i] != '.' ) continue;
+        auto const rule = rules.constFind( QByteArray::fromRawData( name + i + 1, length - i - 1 ) );
+        if( rule != rules.cend() ){
+            address = rule.value();
+            return true;
+        }
+    }
+    return false;
+}
+
+int DnsTable::Size() const
+{
+    QReadLocker locker{ &lock };
+    return hosts.size() + rules.size();
+}
@@ -0,0 +1,48 @@
+#ifndef DNS_TABLE_HPP
+#define DNS_TABLE_HPP
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+#include "alias.hpp"
+#include "alias_snapshot.hpp"
+
+// What the DNS responder answers from: lowercased host name -> address, plus the
+// wildcard rules, readable from the responder's thread while it is kept in step with the
+// published AliasSnapshots. Keeping in step only looks at aliases whose revision moved,
+// so a repoint costs the size of the aliases it touched, not of the whole table.
+class DnsTable
+{
+public:
+    DnsTable();
+
+    // one thread at a time, any thread: it only reads the snapshot. Aliases that
+    // disappeared take their names with them, a version already synced costs nothing
+    void Sync( AliasSnapshotPtr const & snapshot );
+    // any thread. `name` lowercased and without the trailing dot. A name pointed one by one
+    // wins over a rule, a more specific rule over a broader one
+    bool Lookup( char const * name, int length, IpAddress & address ) const;
+    int  Size() const;
+private:
+    struct SyncedAlias {
+        quint64               revision;
+        IpAddress             address;
+        std::vector<DomainId> domains;
+        QStringList           wildcards;
+    };
+
+    static QByteArray Key( QString const & name );
+
+    mutable QReadWriteLock        lock;
+    QHash<QByteArray, IpAddress>  hosts;
+    QHash<QByteArray, IpAddress>  rules;  // "*.staging.corp" is kept as "staging.corp"
+    QHash<QString, SyncedAlias>   synced; // Sync only, what `hosts` and `rules` were built from
+    quint64                       synced_version;
+};
+
+#endif // DNS_TABLE_HPP
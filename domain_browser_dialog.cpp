@@ -0,0 +1,74 @@
+#include "domain_browser_dialog.hpp"
+#include "domain_model.hpp"
+#include <QGridLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTableView>
+
+domain_browser_dialog::domain_browser_dialog( QHash<DomainId, QString> const & domain_owners,
+                                              QHash<DomainId, QString> rule_hosts, QStringList const & pinned,
+                                              QWidget *parent ):
+    QDialog{ parent }, model{ nullptr }, table_view{ nullptr }, filter_line_edit{ nullptr }, pin_button{ nullptr },
+    pinned_domains{ pinned }, selected_domain{}, request{ Request::Point }
+{
+    model = new DomainModel( domain_owners, std::move( rule_hosts ), this );
+
+    filter_line_edit = new QLineEdit();
+    filter_line_edit->setPlaceholderText( "Filter domains" );
+    filter_line_edit->setClearButtonEnabled( true );
+    QObject::connect( filter_line_edit, &QLineEdit::textChanged, model, &DomainModel::SetFilter );
+
+    table_view = new QTableView();
+    table_view->setModel( model );
+    table_view->setSelectionBehavior( QAbstractItemView::SelectRows );
+    table_view->setSelectionMode( QAbstractItemView::SingleSelection );
+    table_view->setEditTriggers( QAbstractItemView::NoEditTriggers );
+    table_view->verticalHeader()->hide();
+    table_view->horizontalHeader()->setStretchLastSection( true );
+    QObject::connect( table_view, &QTableView::doubleClicked, [this]{ AcceptSelection( Request::Point ); } );
+
+    QPushButton *point_button = new QPushButton( "Point..." );
+    pin_button = new QPushButton( "Pin to tray menu" );
+    QObject::connect( point_button, &QPushButton::clicked, [this]{ AcceptSelection( Request::Point ); } );
+    QObject::connect( pin_button, &QPushButton::clicked, [this]{
+        AcceptSelection( pinned_domains.contains( CurrentDomain() ) ? Request::Unpin : Request::Pin );
+    });
+    // the same button takes a pinned domain off the menu again
+    QObject::connect( table_view->selectionModel(), &QItemSelectionModel::selectionChanged, [this]{
+        pin_button->setText( pinned_domains.contains( CurrentDomain() ) ? "Unpin from tray menu" : "Pin to tray menu" );
+    });
+
+    QGridLayout *layout = new QGridLayout();
+    layout->addWidget( new QLabel( "Search" ), 0, 0 );
+    layout->addWidget( filter_line_edit, 0, 1, 1, 2 );
+    layout->addWidget( table_view, 1, 0, 1, 3 );
+    layout->addWidget( pin_button, 2, 1 );
+    layout->addWidget( point_button, 2, 2 );
+    this->setLayout( layout );
+    this->setWindowTitle( "Domains" );
+    this->resize( 480, 400 );
+}
+
+QString domain_browser_dialog::CurrentDomain() const
+{
+    QModelIndexList const rows = table_view->selectionModel()->selectedRows();
+    return rows.isEmpty() ? QString{} : model->DomainAt( rows.first().row() );
+}
+
+void domain_browser_dialog::AcceptSelection( Request new_request )
+{
+    QString const domain = CurrentDomain();
+    if( domain.isEmpty() ){
+        QMessageBox::information( this, windowTitle(), "Select a domain first" );
+        return;
+    }
+    selected_domain = domain;
+    request = new_request;
+    this->accept();
+}
+
+QString domain_browser_dialog::SelectedDomain() const { return selected_domain; }
+domain_browser_dialog::Request domain_browser_dialog::SelectedRequest() const { return request; }
@@ -0,0 +1,48 @@
+#ifndef DOMAIN_BROWSER_DIALOG_HPP
+#define DOMAIN_BROWSER_DIALOG_HPP
+
+#include <QDialog>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include "domain_pool.hpp"
+
+// forward declarations
+class QWidget;
+class QLineEdit;
+class QPushButton;
+class QTableView;
+class DomainModel;
+
+// searchable list of every known domain, pointed ones and those a rule covers; accepting
+// it hands back the chosen domain, either to point it somewhere else or to pin it to( or
+// unpin it from ) the tray's "Point to" menu
+class domain_browser_dialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    enum class Request {
+        Point,
+        Pin,
+        Unpin
+    };
+
+    domain_browser_dialog( QHash<DomainId, QString> const & domain_owners, QHash<DomainId, QString> rule_hosts,
+                           QStringList const & pinned, QWidget *parent = nullptr );
+    QString SelectedDomain() const;
+    Request SelectedRequest() const;
+private:
+    void    AcceptSelection( Request request );
+    QString CurrentDomain() const;
+
+    DomainModel *model;
+    QTableView  *table_view;
+    QLineEdit   *filter_line_edit;
+    QPushButton *pin_button;
+    QStringList pinned_domains;
+    QString     selected_domain;
+    Request     request;
+};
+
+#endif // DOMAIN_BROWSER_DIALOG_HPP
@@ -0,0 +1,100 @@
+#include "domain_model.hpp"
+#include <algorithm>
+
+int const DomainModel::s_page_size = 256;
+
+DomainModel::DomainModel( QHash<DomainId, QString> const & domain_owners, QHash<DomainId, QString> rule_hosts,
+                          QObject *parent ):
+    QAbstractTableModel{ parent }, owners{ domain_owners }, rule_hosts{ std::move( rule_hosts ) }, names{}, rows{},
+    filter{}, matches{}, loaded{ 0 }
+{
+    Reload();
+}
+
+int DomainModel::rowCount( QModelIndex const & parent ) const
+{
+    return parent.isValid() ? 0 : loaded;
+}
+
+int DomainModel::columnCount( QModelIndex const & parent ) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant DomainModel::data( QModelIndex const & index, int role ) const
+{
+    if( !index.isValid() || index.row() >= loaded || role != Qt::DisplayRole ) return QVariant{};
+    DomainId const id = matches[index.row()];
+    if( index.column() == DomainColumn ) return DomainPool::Global().Name( id );
+    auto const owner = owners.constFind( id );
+    return owner != owners.cend() ? owner.value() : rule_hosts.value( id );
+}
+
+QVariant DomainModel::headerData( int section, Qt::Orientation orientation, int role ) const
+{
+    if( orientation != Qt::Horizontal || role != Qt::DisplayRole ) return QVariant{};
+    return section == DomainColumn ? tr( "Domain" ) : tr( "Alias" );
+}
+
+bool DomainModel::canFetchMore( QModelIndex const & parent ) const
+{
+    return !parent.isValid() && static_cast<std::size_t>( loaded ) < matches.size();
+}
+
+void DomainModel::fetchMore( QModelIndex const & parent )
+{
+    if( parent.isValid() ) return;
+    int const remaining = static_cast<int>( matches.size() ) - loaded;
+    int const page = qMin( remaining, s_page_size );
+    if( page <= 0 ) return;
+    beginInsertRows( QModelIndex{}, loaded, loaded + page - 1 );
+    loaded += page;
+    endInsertRows();
+}
+
+void DomainModel::SetFilter( QString const & text )
+{
+    QByteArray const new_filter = text.trimmed().toLower().toUtf8();
+    if( new_filter == filter ) return;
+    filter = new_filter;
+    ApplyFilter();
+}
+
+void DomainModel::Reload()
+{
+    names.clear();
+    rows.clear();
+    rows.reserve( static_cast<std::size_t>( owners.size() + rule_hosts.size() ) );
+    DomainPool const &pool = DomainPool::Global();
+    auto add = [&]( DomainId id ){
+        QByteArray const name = pool.Utf8( id ).toLower();
+        rows.push_back( Row{ id, static_cast<quint32>( names.size() ), static_cast<quint32>( name.size() ) } );
+        names.insert( names.end(), name.cbegin(), name.cend() );
+    };
+    for( auto iter = owners.cbegin(); iter != owners.cend(); ++iter ) add( iter.key() );
+    for( auto iter = rule_hosts.cbegin(); iter != rule_hosts.cend(); ++iter ){
+        if( !owners.contains( iter.key() ) ) add( iter.key() );
+    }
+    std::sort( rows.begin(), rows.end(), []( Row const & a, Row const & b ){ return a.id < b.id; } );
+    ApplyFilter();
+}
+
+void DomainModel::ApplyFilter()
+{
+    beginResetModel();
+    matches.clear();
+    for( auto const & row: rows ){
+        char const *begin = names.data() + row.offset, *end = begin + row.length;
+        if( filter.isEmpty() || std::search( begin, end, filter.cbegin(), filter.cend() ) != end ){
+            matches.push_back( row.id );
+        }
+    }
+    loaded = 0;
+    endResetModel();
+}
+
+QString DomainModel::DomainAt( int row ) const
+{
+    if( row < 0 || row >= loaded ) return QString{};
+    return DomainPool::Global().Name( matches[row] );
+}
@@ -0,0 +1,63 @@
+#ifndef DOMAIN_MODEL_HPP
+#define DOMAIN_MODEL_HPP
+
+#include <QAbstractTableModel>
+#include <QByteArray>
+#include <QHash>
+#include <vector>
+
+#include "domain_pool.hpp"
+
+// Domain | Alias rows over MainWindow's domain -> alias index and the hosts its rules
+// own. Names are lowercased once, when the rows are indexed, so filtering is a plain
+// substring search per row; only the ids of the matching domains are kept, names are
+// looked up when a row is painted and rows are handed to the view a page at a time
+// through fetchMore.
+class DomainModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        DomainColumn,
+        AliasColumn,
+        ColumnCount
+    };
+
+    // `rule_hosts` are the hosts only a rule points, see AliasStore::RuleHosts
+    DomainModel( QHash<DomainId, QString> const & domain_owners, QHash<DomainId, QString> rule_hosts,
+                 QObject *parent = nullptr );
+
+    int      rowCount( QModelIndex const & parent = QModelIndex() ) const override;
+    int      columnCount( QModelIndex const & parent = QModelIndex() ) const override;
+    QVariant data( QModelIndex const & index, int role = Qt::DisplayRole ) const override;
+    QVariant headerData( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const override;
+    bool     canFetchMore( QModelIndex const & parent ) const override;
+    void     fetchMore( QModelIndex const & parent ) override;
+
+    // case insensitive substring match on the domain name, empty shows everything
+    void     SetFilter( QString const & text );
+    // call after domains were added or removed, the names are indexed again
+    void     Reload();
+    QString  DomainAt( int row ) const;
+
+    static int const s_page_size;
+private:
+    struct Row {
+        DomainId id;
+        quint32  offset; // of its lowercased name in `names`
+        quint32  length;
+    };
+
+    void     ApplyFilter();
+
+    QHash<DomainId, QString> const & owners;
+    QHash<DomainId, QString> rule_hosts;
+    std::vector<char>      names;
+    std::vector<Row>       rows; // by id
+    QByteArray             filter;
+    std::vector<DomainId>  matches;
+    int                    loaded;
+};
+
+#endif // DOMAIN_MODEL_HPP
@@ -0,0 +1,111 @@
+#include "domain_pool.hpp"
+#include <QHash>
+#include <cstring>
+#include <limits>
+
+DomainId const DomainPool::s_empty_slot = std::numeric_limits<DomainId>::max();
+
+DomainPool::DomainPool(): lock{}, bytes{}, offsets{ 0 }, slots( 1024, s_empty_slot )
+{
+}
+
+DomainPool & DomainPool::Global()
+{
+    static DomainPool pool {};
+    return pool;
+}
+
+uint DomainPool::Hash( char const * utf8, int length )
+{
+    return qHashBits( utf8, static_cast<size_t>( length ) );
+}
+
+std::size_t DomainPool::Probe( char const * utf8, int length, uint hash ) const
+{
+    std::size_t const mask = slots.size() - 1;
+    for( std::size_t index = hash & mask; ; index = ( index + 1 ) & mask ){
+        DomainId const id = slots[index];
+        if( id == s_empty_slot ) return index;
+        quint32 const begin = offsets[id], end = offsets[id + 1];
+        if( end - begin == static_cast<quint32>( length ) &&
+                std::memcmp( bytes.data() + begin, utf8, length ) == 0 ){
+            return index;
+        }
+    }
+}
+
+void DomainPool::Rehash( std::size_t new_capacity )
+{
+    std::vector<DomainId>( new_capacity, s_empty_slot ).swap( slots );
+    std::size_t const mask = new_capacity - 1;
+    for( DomainId id = 0; id + 1 < offsets.size(); ++id ){
+        char const *name = bytes.data() + offsets[id];
+        int const length = static_cast<int>( offsets[id + 1] - offsets[id] );
+        std::size_t index = Hash( name, length ) & mask;
+        while( slots[index] != s_empty_slot ) index = ( index + 1 ) & mask;
+        slots[index] = id;
+    }
+}
+
+DomainId DomainPool::Intern( QString const & domain_name )
+{
+    QByteArray const utf8 = domain_name.toUtf8();
+    return Intern( utf8.constData(), utf8.size() );
+}
+
+DomainId DomainPool::Intern( char const * utf8, int length )
+{
+    uint const hash = Hash( utf8, length );
+    QWriteLocker locker{ &lock };
+    std::size_t index = Probe( utf8, length, hash );
+    if( slots[index] != s_empty_slot ) return slots[index];
+
+    DomainId const id = static_cast<DomainId>( offsets.size() - 1 );
+    bytes.insert( bytes.end(), utf8, utf8 + length );
+    offsets.push_back( static_cast<quint32>( bytes.size() ) );
+    slots[index] = id;
+
+    // keep the table at most half full so probe sequences stay short
+    if( offsets.size() * 2 > slots.size() ) Rehash( slots.size() * 2 );
+    return id;
+}
+
+bool DomainPool::Find( QString const & domain_name, DomainId & id ) const
+{
+    QByteArray const utf8 = domain_name.toUtf8();
+    uint const hash = Hash( utf8.constData(), utf8.size() );
+    QReadLocker locker{ &lock };
+    std::size_t const index = Probe( utf8.constData(), utf8.size(), hash );
+    if( slots[index] == s_empty_slot ) return false;
+    id = slots[index];
+    return true;
+}
+
+QString DomainPool::Name( DomainId id ) const
+{
+    QReadLocker locker{ &lock };
+    Q_ASSERT( id + 1 < offsets.size() );
+    quint32 const begin = offsets[id];
+    return QString::fromUtf8( bytes.data() + begin, static_cast<int>( offsets[id + 1] - begin ) );
+}
+
+QByteArray DomainPool::Utf8( DomainId id ) const
+{
+    QReadLocker locker{ &lock };
+    Q_ASSERT( id + 1 < offsets.size() );
+    quint32 const begin = offsets[id];
+    return QByteArray( bytes.data() + begin, static_cast<int>( offsets[id + 1] - begin ) );
+}
+
+int DomainPool::Size() const
+{
+    QReadLocker locker{ &lock };
+    return static_cast<int>( offsets.size() - 1 );
+}
+
+qint64 DomainPool::MemoryUsage() const
+{
+    QReadLocker locker{ &lock };
+    return static_cast<qint64>( bytes.capacity() + offsets.capacity() * sizeof( quint32 ) +
+                                slots.capacity() * sizeof( DomainId ) );
+}
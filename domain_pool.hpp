@@ -0,0 +1,46 @@
+#ifndef DOMAIN_POOL_HPP
+#define DOMAIN_POOL_HPP
+
+#include <QByteArray>
+#include <QReadWriteLock>
+#include <QString>
+#include <vector>
+
+using DomainId = quint32;
+
+// Every domain name the application knows about is stored once, as UTF-8 bytes
+// packed back to back in a single arena, and referred to everywhere else by its
+// integer id. Ids are never reused or invalidated, so they are safe to hold on to.
+class DomainPool
+{
+public:
+    static DomainPool & Global();
+
+    DomainId Intern( QString const & domain_name );
+    DomainId Intern( char const * utf8, int length );
+    // lookup without inserting
+    bool     Find( QString const & domain_name, DomainId & id ) const;
+    QString  Name( DomainId id ) const;
+    QByteArray Utf8( DomainId id ) const;
+    int      Size() const;
+    // bytes held by the arena, offsets and hash table
+    qint64   MemoryUsage() const;
+private:
+    DomainPool();
+    DomainPool( DomainPool const & ) = delete;
+    DomainPool & operator=( DomainPool const & ) = delete;
+
+    static uint Hash( char const * utf8, int length );
+    // index of the slot holding the name, or of the empty slot it would go in
+    std::size_t  Probe( char const * utf8, int length, uint hash ) const;
+    void         Rehash( std::size_t new_capacity );
+
+    static DomainId const s_empty_slot;
+
+    mutable QReadWriteLock  lock;
+    std::vector<char>       bytes;
+    std::vector<quint32>    offsets; // name i is bytes[offsets[i], offsets[i + 1])
+    std::vector<DomainId>   slots;   // open addressing, linear probing
+};
+
+#endif // DOMAIN_POOL_HPP
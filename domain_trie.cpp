@@ -0,0 +1,145 @@
+#include "domain_trie.hpp"
+#include <algorithm>
+#include <limits>
+
+DomainId const DomainTrie::s_no_host = std::numeric_limits<DomainId>::max();
+quint32 const DomainTrie::s_no_node = std::numeric_limits<quint32>::max();
+
+DomainTrie::DomainTrie(): nodes( 1, Node{ {}, {}, s_no_host } ), rule_count{ 0 }
+{
+}
+
+bool DomainTrie::IsWildcard( QString const & pattern )
+{
+    return pattern.size() > 2 && pattern.startsWith( "*." ) && !pattern.contains( "..", Qt::CaseSensitive ) &&
+            pattern.indexOf( '*', 1 ) < 0;
+}
+
+// right to left, names compare case-insensitively
+QStringList DomainTrie::Labels( QString const & domain_name )
+{
+#if QT_VERSION >= QT_VERSION_CHECK( 5, 14, 0 )
+    QStringList labels = domain_name.toLower().split( '.', Qt::SkipEmptyParts );
+#else
+    QStringList labels = domain_name.toLower().split( '.', QString::SkipEmptyParts );
+#endif
+    std::reverse( labels.begin(), labels.end() );
+    return labels;
+}
+
+quint32 DomainTrie::FindOrCreate( QStringList const & labels )
+{
+    quint32 index = 0;
+    for( auto const & label: labels ){
+        auto child = nodes[index].children.constFind( label );
+        if( child != nodes[index].children.cend() ){
+            index = child.value();
+            continue;
+        }
+        quint32 const added = static_cast<quint32>( nodes.size() );
+        nodes[index].children.insert( label, added );
+        nodes.push_back( Node{ {}, {}, s_no_host } );
+        index = added;
+    }
+    return index;
+}
+
+quint32 DomainTrie::Find( QStringList const & labels ) const
+{
+    quint32 index = 0;
+    for( auto const & label: labels ){
+        auto child = nodes[index].children.constFind( label );
+        if( child == nodes[index].children.cend() ) return s_no_node;
+        index = child.value();
+    }
+    return index;
+}
+
+void DomainTrie::AddHost( DomainId id )
+{
+    nodes[FindOrCreate( Labels( DomainPool::Global().Name( id ) ) )].host = id;
+}
+
+bool DomainTrie::Covers( QString const & domain_name ) const
+{
+    return rule_count != 0 && !Match( domain_name ).isEmpty();
+}
+
+void DomainTrie::RemoveHost( DomainId id )
+{
+    quint32 const index = Find( Labels( DomainPool::Global().Name( id ) ) );
+    if( index != s_no_node && nodes[index].host == id ) nodes[index].host = s_no_host;
+}
+
+bool DomainTrie::HasHost( DomainId id ) const
+{
+    quint32 const index = Find( Labels( DomainPool::Global().Name( id ) ) );
+    return index != s_no_node && nodes[index].host == id;
+}
+
+void DomainTrie::SetRule( QString const & pattern, QString const & alias_name )
+{
+    Q_ASSERT( IsWildcard( pattern ) );
+    QString &owner = nodes[FindOrCreate( Labels( pattern.mid( 2 ) ) )].rule_owner;
+    if( owner.isEmpty() && !alias_name.isEmpty() ) ++rule_count;
+    owner = alias_name;
+}
+
+void DomainTrie::RemoveRule( QString const & pattern )
+{
+    quint32 const index = Find( Labels( pattern.mid( 2 ) ) );
+    if( index == s_no_node || nodes[index].rule_owner.isEmpty() ) return;
+    nodes[index].rule_owner.clear();
+    --rule_count;
+}
+
+QString DomainTrie::Match( QString const & domain_name, QString *pattern ) const
+{
+    QStringList const labels = Labels( domain_name );
+    quint32 index = 0, owner = s_no_node;
+    int owner_depth = 0;
+    // a rule only covers names strictly below its node, so the last label never matches
+    for( int depth = 0; depth + 1 < labels.size(); ++depth ){
+        auto child = nodes[index].children.constFind( labels[depth] );
+        if( child == nodes[index].children.cend() ) break;
+        index = child.value();
+        if( !nodes[index].rule_owner.isEmpty() ){
+            owner = index;
+            owner_depth = depth + 1;
+        }
+    }
+    if( owner == s_no_node ) return QString{};
+    if( pattern ){
+        QStringList suffix = labels.mid( 0, owner_depth );
+        std::reverse( suffix.begin(), suffix.end() );
+        *pattern = "*." + suffix.join( '.' );
+    }
+    return nodes[owner].rule_owner;
+}
+
+std::vector<DomainId> DomainTrie::Expand( QString const & pattern ) const
+{
+    std::vector<DomainId> hosts {};
+    quint32 const start = Find( Labels( pattern.mid( 2 ) ) );
+    if( start == s_no_node ) return hosts;
+
+    std::vector<quint32> pending{ start };
+    while( !pending.empty() ){
+        quint32 const index = pending.back();
+        Node const & node = nodes[index];
+        pending.pop_back();
+        if( index != start && node.host != s_no_host ) hosts.push_back( node.host );
+        for( quint32 const child: node.children ){
+            // a more specific rule takes everything below it
+            if( nodes[child].rule_owner.isEmpty() ) pending.push_back( child );
+            else if( nodes[child].host != s_no_host ) hosts.push_back( nodes[child].host );
+        }
+    }
+    return hosts;
+}
+
+void DomainTrie::Clear()
+{
+    std::vector<Node>( 1, Node{ {}, {}, s_no_host } ).swap( nodes );
+    rule_count = 0;
+}
@@ -0,0 +1,58 @@
+#ifndef DOMAIN_TRIE_HPP
+#define DOMAIN_TRIE_HPP
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+#include "domain_pool.hpp"
+
+// Domain names stored label by label from the right( corp -> staging -> www ), so
+// everything below a name is one subtree. A node can carry a wildcard rule, "*.staging.corp"
+// lives on the staging node and covers every name strictly below it, and/or mark a
+// known host. Lookups walk one node per label and never depend on how many names are stored.
+// Only hosts that fall under a rule need to be in it: a host no rule covers has nothing
+// to be matched against.
+class DomainTrie
+{
+public:
+    DomainTrie();
+
+    // "*.staging.corp" is a rule, "staging.corp" and "*" are not
+    static bool IsWildcard( QString const & pattern );
+
+    void AddHost( DomainId id );
+    // whether some rule covers `domain_name`, free while there are no rules at all
+    bool Covers( QString const & domain_name ) const;
+    void RemoveHost( DomainId id );
+    bool HasHost( DomainId id ) const;
+    void SetRule( QString const & pattern, QString const & alias_name );
+    void RemoveRule( QString const & pattern );
+    // the alias of the most specific rule covering `domain_name`, empty when none does.
+    // `pattern` receives the rule itself
+    QString Match( QString const & domain_name, QString *pattern = nullptr ) const;
+    // known hosts the rule owns: those below it and not below a more specific rule
+    std::vector<DomainId> Expand( QString const & pattern ) const;
+    void Clear();
+
+private:
+    struct Node {
+        QHash<QString, quint32> children; // label -> node index
+        QString                 rule_owner;
+        DomainId                host;
+    };
+
+    static QStringList Labels( QString const & domain_name );
+    quint32 FindOrCreate( QStringList const & labels );
+    // s_no_node if there is no such node
+    quint32 Find( QStringList const & labels ) const;
+
+    static DomainId const s_no_host;
+    static quint32 const  s_no_node;
+
+    std::vector<Node> nodes; // nodes[0] is the root
+    int               rule_count;
+};
+
+#endif // DOMAIN_TRIE_HPP
@@ -0,0 +1,132 @@
+#include "hosts_parser.hpp"
+#include "hosts_scanner.hpp"
+#include "statistics.hpp"
+#include <QFile>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+#include <cstring>
+
+namespace {
+    struct Chunk {
+        char const *data;
+        qint64      size;
+    };
+
+    // below this a chunk costs more to schedule than to parse
+    qint64 const s_min_chunk_size = 1 << 20;
+}
+
+qint64 const HostsParser::s_parallel_threshold = 8 << 20;
+
+bool HostsParser::ParseFile( QString const & filename, HostsMapping & mapping, ImportMode mode )
+{
+    QFile file{ filename };
+    if( !file.exists() || !file.open( QIODevice::ReadOnly ) ){
+        return false;
+    }
+    qint64 const size = file.size();
+    if( size == 0 ) return true;
+
+    ScopedTimer const timer{ Statistics::HostsParse };
+    Statistics::Global().AddBytesRead( Statistics::HostsParse, size );
+
+    bool const parallel = mode == ImportMode::Parallel ||
+            ( mode == ImportMode::Automatic && size >= s_parallel_threshold );
+    auto parse = parallel ? &HostsParser::ParseBufferParallel : &HostsParser::ParseBuffer;
+
+    uchar *mapped = file.map( 0, size );
+    if( mapped ){
+        parse( reinterpret_cast<char const *>( mapped ), size, mapping );
+        file.unmap( mapped );
+    } else { // some devices( pipes, special files ) can't be mapped
+        QByteArray const content = file.readAll();
+        parse( content.constData(), content.size(), mapping );
+    }
+    file.close();
+    return true;
+}
+
+void HostsParser::ParseBuffer( char const * data, qint64 size, HostsMapping & mapping )
+{
+    static HostsScanner const scanner {};
+
+    // skip the UTF-8 BOM some editors on Windows leave behind
+    if( size >= 3 && std::memcmp( data, "\xEF\xBB\xBF", 3 ) == 0 ){
+        data += 3;
+        size -= 3;
+    }
+
+    // blocklists repeat the same address on every line, so remember where the last one went
+    char const *last_ip = nullptr;
+    std::size_t last_ip_length = 0;
+    qint64 entries = 0;
+    HostsMapping::iterator last_entry = mapping.end();
+
+    // the hosts file are mapped like so: IP_Address HostName [aliases...], such that they're
+    // separated by at least a single whitespace
+    scanner.Scan( data, static_cast<std::size_t>( size ),
+                  [&]( HostsScanner::Field const * fields, std::size_t count )
+    {
+        if( count < 2 ) return;
+        char const *ip = data + fields[0].offset;
+        std::size_t const ip_length = fields[0].length;
+        if( last_entry == mapping.end() || ip_length != last_ip_length ||
+                std::memcmp( ip, last_ip, ip_length ) != 0 ){
+            IpAddress address {};
+            if( !IpAddress::Parse( ip, static_cast<int>( ip_length ), address ) ){
+                last_entry = mapping.end();
+                return;
+            }
+            last_entry = mapping.find( address );
+            if( last_entry == mapping.end() ){
+                last_entry = mapping.insert( address, QList<QString>{} );
+            }
+            last_ip = ip;
+            last_ip_length = ip_length;
+        }
+        for( std::size_t i = 1; i != count; ++i ){
+            last_entry->append( QString::fromUtf8( data + fields[i].offset,
+                                                   static_cast<int>( fields[i].length ) ) );
+        }
+        entries += static_cast<qint64>( count - 1 );
+    });
+    Statistics::Global().AddEntries( Statistics::HostsParse, entries );
+}
+
+void HostsParser::ParseBufferParallel( char const * data, qint64 size, HostsMapping & mapping )
+{
+    // a few chunks per core so one slow chunk doesn't hold up the rest
+    qint64 const wanted = qMax( 1, QThread::idealThreadCount() ) * 4;
+    qint64 const chunk_size = qMax( s_min_chunk_size, size / wanted + 1 );
+
+    QVector<Chunk> chunks {};
+    char const * const end = data + size;
+    for( char const *begin = data; begin != end; ){
+        char const *split = end - begin > chunk_size ? begin + chunk_size : end;
+        if( split != end ){ // never cut a line in half
+            split = static_cast<char const *>( std::memchr( split, '\n', end - split ) );
+            split = split ? split + 1 : end;
+        }
+        chunks.append( Chunk{ begin, split - begin } );
+        begin = split;
+    }
+    if( chunks.size() < 2 ){
+        ParseBuffer( data, size, mapping );
+        return;
+    }
+
+    QVector<HostsMapping> const partials = QtConcurrent::blockingMapped<QVector<HostsMapping>>(
+                chunks, []( Chunk const & chunk ){
+        HostsMapping partial {};
+        ParseBuffer( chunk.data, chunk.size, partial );
+        return partial;
+    });
+
+    // merging in chunk order keeps every address' host list in file order
+    for( auto const & partial: partials ){
+        for( auto iter = partial.cbegin(); iter != partial.cend(); ++iter ){
+            mapping[iter.key()].append( iter.value() );
+        }
+    }
+}
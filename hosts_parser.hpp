@@ -0,0 +1,35 @@
+#ifndef HOSTS_PARSER_HPP
+#define HOSTS_PARSER_HPP
+
+#include <QList>
+#include <QMap>
+#include <QString>
+#include "ip_address.hpp"
+
+// IP address -> every host name that points to it, in file order. Addresses are
+// ordered numerically
+using HostsMapping = QMap<IpAddress, QList<QString>>;
+
+class HostsParser
+{
+public:
+    enum class ImportMode {
+        Automatic, // parallel once the file is big enough to be worth it
+        Serial,
+        Parallel
+    };
+
+    // memory-maps the file and tokenizes it in place. Strings are only created
+    // for what ends up in `mapping`, every host name on a line is kept. Lines that
+    // don't start with a valid address are skipped
+    static bool ParseFile( QString const & filename, HostsMapping & mapping,
+                           ImportMode mode = ImportMode::Automatic );
+    static void ParseBuffer( char const * data, qint64 size, HostsMapping & mapping );
+    // splits the buffer on newline boundaries and parses the chunks concurrently. The merged
+    // result is identical to ParseBuffer's
+    static void ParseBufferParallel( char const * data, qint64 size, HostsMapping & mapping );
+
+    static qint64 const s_parallel_threshold;
+};
+
+#endif // HOSTS_PARSER_HPP
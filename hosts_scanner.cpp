@@ -0,0 +1,126 @@
+#include "hosts_scanner.hpp"
+
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ ) || defined( _M_IX86 )
+#define HOSTS_SCANNER_X86
+#include <immintrin.h>
+#endif
+
+#if defined( HOSTS_SCANNER_X86 ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define HOSTS_SCANNER_TARGET( arch ) __attribute__(( target( arch ) ))
+#else
+#define HOSTS_SCANNER_TARGET( arch )
+#endif
+
+namespace {
+    inline bool IsSpecial( unsigned char c ){
+        return c == ' ' || c == '#' || ( c >= '\t' && c <= '\r' );
+    }
+
+    std::uint64_t ClassifyScalar( char const * block )
+    {
+        std::uint64_t mask = 0;
+        for( int i = 0; i != 64; ++i ){
+            if( IsSpecial( static_cast<unsigned char>( block[i] ) ) ){
+                mask |= std::uint64_t{ 1 } << i;
+            }
+        }
+        return mask;
+    }
+
+#ifdef HOSTS_SCANNER_X86
+    // '\t'..'\r' are contiguous, so one signed range check covers five of the seven bytes;
+    // anything >= 0x80 is negative and falls outside of it
+    HOSTS_SCANNER_TARGET( "sse2" )
+    std::uint64_t ClassifySSE2( char const * block )
+    {
+        __m128i const space = _mm_set1_epi8( ' ' ), hash = _mm_set1_epi8( '#' );
+        __m128i const low = _mm_set1_epi8( '\t' - 1 ), high = _mm_set1_epi8( '\r' + 1 );
+        std::uint64_t mask = 0;
+        for( int i = 0; i != 4; ++i ){
+            __m128i const bytes = _mm_loadu_si128( reinterpret_cast<__m128i const *>( block + i * 16 ) );
+            __m128i const in_range = _mm_and_si128( _mm_cmpgt_epi8( bytes, low ), _mm_cmplt_epi8( bytes, high ) );
+            __m128i const special = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( bytes, space ),
+                                                                _mm_cmpeq_epi8( bytes, hash ) ), in_range );
+            mask |= static_cast<std::uint64_t>( static_cast<unsigned>( _mm_movemask_epi8( special ) ) ) << ( i * 16 );
+        }
+        return mask;
+    }
+
+    HOSTS_SCANNER_TARGET( "avx2" )
+    std::uint64_t ClassifyAVX2( char const * block )
+    {
+        __m256i const space = _mm256_set1_epi8( ' ' ), hash = _mm256_set1_epi8( '#' );
+        __m256i const low = _mm256_set1_epi8( '\t' - 1 ), high = _mm256_set1_epi8( '\r' + 1 );
+        std::uint64_t mask = 0;
+        for( int i = 0; i != 2; ++i ){
+            __m256i const bytes = _mm256_loadu_si256( reinterpret_cast<__m256i const *>( block + i * 32 ) );
+            __m256i const in_range = _mm256_and_si256( _mm256_cmpgt_epi8( bytes, low ), _mm256_cmpgt_epi8( high, bytes ) );
+            __m256i const special = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( bytes, space ),
+                                                                      _mm256_cmpeq_epi8( bytes, hash ) ), in_range );
+            mask |= static_cast<std::uint64_t>( static_cast<std::uint32_t>( _mm256_movemask_epi8( special ) ) ) << ( i * 32 );
+        }
+        return mask;
+    }
+
+#if defined( _MSC_VER )
+    bool CpuHasAVX2()
+    {
+        int info[4] = {};
+        __cpuid( info, 0 );
+        if( info[0] < 7 ) return false;
+        __cpuid( info, 1 );
+        bool const os_saves_ymm = ( info[2] & ( 1 << 27 ) ) && ( _xgetbv( 0 ) & 0x6 ) == 0x6;
+        __cpuidex( info, 7, 0 );
+        return os_saves_ymm && ( info[1] & ( 1 << 5 ) );
+    }
+    bool CpuHasSSE2()
+    {
+#if defined( _M_X64 )
+        return true;
+#else
+        int info[4] = {};
+        __cpuid( info, 1 );
+        return ( info[3] & ( 1 << 26 ) ) != 0;
+#endif
+    }
+#else
+    bool CpuHasAVX2(){ return __builtin_cpu_supports( "avx2" ); }
+    bool CpuHasSSE2(){ return __builtin_cpu_supports( "sse2" ); }
+#endif
+#endif // HOSTS_SCANNER_X86
+}
+
+HostsScanner::HostsScanner( Kernel kernel_ ): kernel{ IsSupported( kernel_ ) ? kernel_ : Kernel::Scalar },
+    classify{ ClassifyScalar }
+{
+#ifdef HOSTS_SCANNER_X86
+    switch( kernel ){
+    case Kernel::AVX2: classify = ClassifyAVX2; break;
+    case Kernel::SSE2: classify = ClassifySSE2; break;
+    default:;
+    }
+#endif
+}
+
+bool HostsScanner::IsSupported( Kernel kernel )
+{
+    switch( kernel ){
+#ifdef HOSTS_SCANNER_X86
+    case Kernel::AVX2: return CpuHasAVX2();
+    case Kernel::SSE2: return CpuHasSSE2();
+#endif
+    case Kernel::Scalar: return true;
+    default: return false;
+    }
+}
+
+HostsScanner::Kernel HostsScanner::BestKernel()
+{
+    if( IsSupported( Kernel::AVX2 ) ) return Kernel::AVX2;
+    if( IsSupported( Kernel::SSE2 ) ) return Kernel::SSE2;
+    return Kernel::Scalar;
+}
+
+HostsScanner::Kernel HostsScanner::ActiveKernel() const { return kernel; }
+
+#undef HOSTS_SCANNER_TARGET
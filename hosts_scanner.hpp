@@ -0,0 +1,114 @@
+#ifndef HOSTS_SCANNER_HPP
+#define HOSTS_SCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+// Finds the lines and fields of a hosts file. The input is classified 64 bytes at a
+// time into a bitmask of "special" bytes( blanks, '\n' and '#' ) and only those bits
+// are visited, so runs of host name characters are skipped without being looked at.
+// The classification kernel is vectorized where the CPU allows it and chosen at runtime;
+// every kernel produces the same mask, hence the same lines and fields.
+class HostsScanner
+{
+public:
+    enum class Kernel {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    struct Field {
+        std::size_t offset;
+        std::size_t length;
+    };
+
+    // bit i is set when block[i] is one of ' ', '\t', '\n', '\v', '\f', '\r' or '#'
+    using ClassifyFunction = std::uint64_t (*)( char const * block );
+
+    explicit HostsScanner( Kernel kernel = BestKernel() );
+
+    static Kernel BestKernel();
+    static bool   IsSupported( Kernel kernel );
+    Kernel        ActiveKernel() const;
+
+    // calls handler( Field const * fields, std::size_t count ) for every line with at least
+    // one field, in order. Comments run from '#' to the end of the line, '\r' is a blank so
+    // CRLF files need no special casing.
+    template<typename LineHandler>
+    void Scan( char const * data, std::size_t size, LineHandler && handler ) const;
+private:
+    static int CountTrailingZeros( std::uint64_t mask );
+
+    Kernel           kernel;
+    ClassifyFunction classify;
+};
+
+inline int HostsScanner::CountTrailingZeros( std::uint64_t mask )
+{
+#if defined( _MSC_VER ) && defined( _M_X64 )
+    unsigned long index = 0;
+    _BitScanForward64( &index, mask );
+    return static_cast<int>( index );
+#elif defined( _MSC_VER )
+    unsigned long index = 0;
+    if( _BitScanForward( &index, static_cast<unsigned long>( mask ) ) ) return static_cast<int>( index );
+    _BitScanForward( &index, static_cast<unsigned long>( mask >> 32 ) );
+    return static_cast<int>( index ) + 32;
+#else
+    return __builtin_ctzll( mask );
+#endif
+}
+
+template<typename LineHandler>
+void HostsScanner::Scan( char const * data, std::size_t size, LineHandler && handler ) const
+{
+    std::vector<Field> fields {};
+    bool in_comment = false;
+    std::size_t field_start = 0; // one past the last special byte seen
+
+    char tail[64];
+    for( std::size_t block = 0; block < size; block += 64 ){
+        std::uint64_t mask = 0;
+        if( size - block >= 64 ){
+            mask = classify( data + block );
+        } else { // '\0' padding is never special
+            std::memset( tail, 0, sizeof( tail ) );
+            std::memcpy( tail, data + block, size - block );
+            mask = classify( tail );
+        }
+        while( mask ){
+            std::size_t const position = block + CountTrailingZeros( mask );
+            mask &= mask - 1;
+
+            if( !in_comment && position > field_start ){
+                fields.push_back( Field{ field_start, position - field_start } );
+            }
+            field_start = position + 1;
+
+            char const c = data[position];
+            if( c == '\n' ){
+                if( !fields.empty() ){
+                    handler( fields.data(), fields.size() );
+                    fields.clear();
+                }
+                in_comment = false;
+            } else if( c == '#' ){
+                in_comment = true;
+            }
+        }
+    }
+    // the last line need not end with a newline
+    if( !in_comment && size > field_start ){
+        fields.push_back( Field{ field_start, size - field_start } );
+    }
+    if( !fields.empty() ) handler( fields.data(), fields.size() );
+}
+
+#endif // HOSTS_SCANNER_HPP
@@ -0,0 +1,218 @@
+#include "hosts_watcher.hpp"
+#include "statistics.hpp"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <cstring>
+
+namespace {
+    // a chunk ends after a line whose hash has these bits clear, ~64 lines on average
+    quint64 const s_boundary_mask = 63;
+    int const     s_min_chunk_size = 4 * 1024;
+    int const     s_max_chunk_size = 256 * 1024;
+    quint64 const s_hash_seed = 14695981039346656037ULL;
+
+    bool ReadWhole( QString const & path, QByteArray & content )
+    {
+        QFile file{ path };
+        if( !file.open( QIODevice::ReadOnly ) ) return false;
+        content = file.readAll();
+        return true;
+    }
+
+    QSet<QString> ToSet( QList<QString> const & list )
+    {
+#if QT_VERSION >= QT_VERSION_CHECK( 5, 14, 0 )
+        return QSet<QString>( list.begin(), list.end() );
+#else
+        return list.toSet();
+#endif
+    }
+
+    // a line that moved from one chunk to another shows up on both sides, it didn't change
+    void DropUnchangedEntries( HostsMapping & added, HostsMapping & removed )
+    {
+        for( auto iter = removed.begin(); iter != removed.end(); ){
+            auto other = added.find( iter.key() );
+            if( other != added.end() ){
+                QSet<QString> const kept = ToSet( *other );
+                QSet<QString> const gone = ToSet( *iter );
+                for( auto domain = iter->begin(); domain != iter->end(); ){
+                    if( kept.contains( *domain ) ) domain = iter->erase( domain );
+                    else ++domain;
+                }
+                for( auto domain = other->begin(); domain != other->end(); ){
+                    if( gone.contains( *domain ) ) domain = other->erase( domain );
+                    else ++domain;
+                }
+                if( other->isEmpty() ) added.erase( other );
+            }
+            if( iter->isEmpty() ) iter = removed.erase( iter );
+            else ++iter;
+        }
+    }
+}
+
+int const HostsFileWatcher::s_settle_ms = 300;
+
+HostsFileWatcher::HostsFileWatcher( QObject *parent ): QObject{ parent },
+    watcher{}, settle_timer{}, hosts_file_path{}, config_file_path{}, hosts_baseline{},
+    hosts_chunks{}, config_hash{ 0 }, hosts_dirty{ false }, config_dirty{ false }, suspended{ 0 }
+{
+    // editors and other tools often write a file in several steps, wait for them to finish
+    settle_timer.setSingleShot( true );
+    settle_timer.setInterval( s_settle_ms );
+    QObject::connect( &settle_timer, &QTimer::timeout, this, &HostsFileWatcher::OnSettled );
+    QObject::connect( &watcher, &QFileSystemWatcher::fileChanged, this, &HostsFileWatcher::OnPathChanged );
+}
+
+void HostsFileWatcher::Watch( QString const & hosts_path, QString const & config_path )
+{
+    if( !watcher.files().isEmpty() ) watcher.removePaths( watcher.files() );
+    hosts_file_path = QFileInfo( hosts_path ).absoluteFilePath();
+    config_file_path = QFileInfo( config_path ).absoluteFilePath();
+    RewatchPaths();
+    TakeBaseline();
+}
+
+void HostsFileWatcher::Suspend()
+{
+    ++suspended;
+}
+
+void HostsFileWatcher::Resume()
+{
+    Q_ASSERT( suspended > 0 );
+    if( --suspended != 0 ) return;
+    settle_timer.stop();
+    hosts_dirty = config_dirty = false;
+    // another program may have edited the hosts file between our write and now, so it is
+    // diffed against what was there before the write rather than taken as is. Our own
+    // changes come back too; the store already holds them, merging them changes nothing
+    DiffHostsFile();
+    // config.json has no entries to diff, whatever is there now is taken to be our write
+    QByteArray config {};
+    config_hash = ReadWhole( config_file_path, config ) ?
+                HashBytes( config.constData(), config.size(), s_hash_seed ) : 0;
+}
+
+void HostsFileWatcher::OnPathChanged( QString const & path )
+{
+    // files replaced through a rename drop out of the watch list
+    RewatchPaths();
+    if( suspended != 0 ) return;
+    if( path == hosts_file_path ) hosts_dirty = true;
+    if( path == config_file_path ) config_dirty = true;
+    settle_timer.start();
+}
+
+void HostsFileWatcher::OnSettled()
+{
+    RewatchPaths();
+    if( suspended != 0 ) return;
+    if( hosts_dirty ){
+        hosts_dirty = false;
+        DiffHostsFile();
+    }
+    if( config_dirty ){
+        config_dirty = false;
+        QByteArray content {};
+        if( ReadWhole( config_file_path, content ) ){
+            quint64 const hash = HashBytes( content.constData(), content.size(), s_hash_seed );
+            // touched but not modified
+            if( hash == config_hash ) return;
+            config_hash = hash;
+            emit ConfigFileChanged();
+        }
+    }
+}
+
+void HostsFileWatcher::RewatchPaths()
+{
+    QStringList const watched = watcher.files();
+    for( auto const & path: { hosts_file_path, config_file_path } ){
+        if( !path.isEmpty() && !watched.contains( path ) && QFileInfo::exists( path ) ) watcher.addPath( path );
+    }
+}
+
+void HostsFileWatcher::TakeBaseline()
+{
+    hosts_dirty = config_dirty = false;
+    settle_timer.stop();
+    if( !ReadWhole( hosts_file_path, hosts_baseline ) ) hosts_baseline.clear();
+    hosts_chunks = SplitIntoChunks( hosts_baseline );
+
+    QByteArray config {};
+    config_hash = ReadWhole( config_file_path, config ) ?
+                HashBytes( config.constData(), config.size(), s_hash_seed ) : 0;
+}
+
+void HostsFileWatcher::DiffHostsFile()
+{
+    QByteArray content {};
+    if( !ReadWhole( hosts_file_path, content ) ) return;
+    if( content == hosts_baseline ) return;
+    Statistics::Global().AddBytesRead( Statistics::HostsParse, content.size() );
+
+    std::vector<Chunk> const chunks = SplitIntoChunks( content );
+    // the same chunk may legitimately appear more than once, so count them
+    QHash<quint64, int> old_counts {}, new_counts {};
+    for( auto const & chunk: hosts_chunks ) ++old_counts[chunk.hash];
+    for( auto const & chunk: chunks ) ++new_counts[chunk.hash];
+
+    HostsMapping added {}, removed {};
+    for( auto const & chunk: hosts_chunks ){
+        int &count = new_counts[chunk.hash];
+        if( count > 0 ) --count;
+        else HostsParser::ParseBuffer( hosts_baseline.constData() + chunk.offset, chunk.length, removed );
+    }
+    for( auto const & chunk: chunks ){
+        int &count = old_counts[chunk.hash];
+        if( count > 0 ) --count;
+        else HostsParser::ParseBuffer( content.constData() + chunk.offset, chunk.length, added );
+    }
+
+    hosts_baseline = content;
+    hosts_chunks = std::move( chunks );
+    DropUnchangedEntries( added, removed );
+    if( !added.isEmpty() || !removed.isEmpty() ) emit HostsEntriesChanged( added, removed );
+}
+
+// FNV-1a
+quint64 HostsFileWatcher::HashBytes( char const * data, int length, quint64 hash )
+{
+    for( int i = 0; i != length; ++i ){
+        hash = ( hash ^ static_cast<uchar>( data[i] ) ) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// boundaries depend only on the lines before them, so inserting or deleting a line
+// moves at most the boundaries around it and every other chunk keeps its hash
+std::vector<HostsFileWatcher::Chunk> HostsFileWatcher::SplitIntoChunks( QByteArray const & content )
+{
+    std::vector<Chunk> chunks {};
+    char const *data = content.constData();
+    int const size = content.size();
+    int chunk_begin = 0;
+    quint64 chunk_hash = s_hash_seed;
+
+    for( int line_begin = 0; line_begin < size; ){
+        void const *newline = std::memchr( data + line_begin, '\n', static_cast<size_t>( size - line_begin ) );
+        int const line_end = newline ? static_cast<int>( static_cast<char const *>( newline ) - data ) + 1 : size;
+        quint64 const line_hash = HashBytes( data + line_begin, line_end - line_begin, s_hash_seed );
+        chunk_hash = HashBytes( data + line_begin, line_end - line_begin, chunk_hash );
+        line_begin = line_end;
+
+        int const chunk_size = line_end - chunk_begin;
+        if( ( chunk_size >= s_min_chunk_size && ( line_hash & s_boundary_mask ) == 0 ) ||
+                chunk_size >= s_max_chunk_size || line_end == size ){
+            chunks.push_back( Chunk{ chunk_hash, chunk_begin, chunk_size } );
+            chunk_begin = line_end;
+            chunk_hash = s_hash_seed;
+        }
+    }
+    return chunks;
+}
@@ -0,0 +1,70 @@
+#ifndef HOSTS_WATCHER_HPP
+#define HOSTS_WATCHER_HPP
+
+#include <QByteArray>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QTimer>
+#include <vector>
+
+#include "hosts_parser.hpp"
+
+// Watches the hosts file and config.json for changes made by other programs.
+//
+// The hosts file is cut into chunks on line boundaries chosen by the content of
+// the lines themselves, so an edit only changes the chunks it touches and the ones
+// after it keep their hashes. On a change only chunks whose hash is new get parsed
+// ( added entries ) and only chunks whose hash disappeared get parsed from the last
+// known copy ( removed entries ).
+//
+// Suspend the watcher before writing and resume it afterwards. Resuming diffs the hosts
+// file against the copy from before the write, so an edit another program made meanwhile
+// is still reported; our own changes are reported along with it and merge as no-ops.
+class HostsFileWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HostsFileWatcher( QObject *parent = nullptr );
+
+    void Watch( QString const & hosts_path, QString const & config_path );
+    void Suspend();
+    void Resume();
+
+    static int const s_settle_ms;
+
+signals:
+    // entries present in both maps were only moved around and are left out of either
+    void HostsEntriesChanged( HostsMapping const & added, HostsMapping const & removed );
+    void ConfigFileChanged();
+
+private slots:
+    void OnPathChanged( QString const & path );
+    void OnSettled();
+
+private:
+    struct Chunk {
+        quint64 hash;
+        int     offset;
+        int     length;
+    };
+
+    static std::vector<Chunk> SplitIntoChunks( QByteArray const & content );
+    static quint64            HashBytes( char const * data, int length, quint64 hash );
+    void                      TakeBaseline();
+    void                      DiffHostsFile();
+    void                      RewatchPaths();
+
+    QFileSystemWatcher  watcher;
+    QTimer              settle_timer;
+    QString             hosts_file_path;
+    QString             config_file_path;
+    QByteArray          hosts_baseline; // what removed chunks get parsed from
+    std::vector<Chunk>  hosts_chunks;
+    quint64             config_hash;
+    bool                hosts_dirty;
+    bool                config_dirty;
+    int                 suspended;
+};
+
+#endif // HOSTS_WATCHER_HPP
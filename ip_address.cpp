@@ -0,0 +1,181 @@
+#include "ip_address.hpp"
+#include <QHash>
+
+namespace {
+    quint64 const s_v4_prefix = Q_UINT64_C( 0x0000ffff00000000 );
+
+    int HexValue( char c )
+    {
+        if( c >= '0' && c <= '9' ) return c - '0';
+        if( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+        if( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+        return -1;
+    }
+
+    bool ParseV4( char const * begin, char const * end, quint32 & value )
+    {
+        value = 0;
+        for( int part = 0; part != 4; ++part ){
+            if( part != 0 ){
+                if( begin == end || *begin != '.' ) return false;
+                ++begin;
+            }
+            int digits = 0;
+            quint32 octet = 0;
+            for( ; begin != end && *begin >= '0' && *begin <= '9'; ++begin, ++digits ){
+                octet = octet * 10 + static_cast<quint32>( *begin - '0' );
+            }
+            if( digits == 0 || digits > 3 || octet > 255 ) return false;
+            value = ( value << 8 ) | octet;
+        }
+        return begin == end;
+    }
+
+    bool ParseV6( char const * begin, char const * end, quint16 ( &groups )[8] )
+    {
+        int count = 0, gap = -1; // gap: index where "::" goes
+        if( end - begin >= 2 && begin[0] == ':' && begin[1] == ':' ){
+            gap = 0;
+            begin += 2;
+        } else if( begin != end && *begin == ':' ){
+            return false;
+        }
+        while( begin != end ){
+            if( count == 8 ) return false;
+            char const *group_end = begin;
+            while( group_end != end && HexValue( *group_end ) >= 0 ) ++group_end;
+            if( group_end != end && *group_end == '.' ){
+                // an IPv4 tail takes the last two groups
+                quint32 v4 = 0;
+                if( count > 6 || !ParseV4( begin, end, v4 ) ) return false;
+                groups[count++] = static_cast<quint16>( v4 >> 16 );
+                groups[count++] = static_cast<quint16>( v4 );
+                begin = end;
+                break;
+            }
+            int const digits = static_cast<int>( group_end - begin );
+            if( digits == 0 || digits > 4 ) return false;
+            quint16 group = 0;
+            for( ; begin != group_end; ++begin ) group = static_cast<quint16>( group << 4 | HexValue( *begin ) );
+            groups[count++] = group;
+            if( begin == end ) break;
+            if( *begin != ':' ) return false;
+            ++begin;
+            if( begin != end && *begin == ':' ){
+                if( gap >= 0 ) return false;
+                gap = count;
+                ++begin;
+            } else if( begin == end ){
+                return false; // a trailing single ':'
+            }
+        }
+        if( gap < 0 ) return count == 8;
+        if( count == 8 ) return false; // "::" has to stand for at least one group
+        int const missing = 8 - count;
+        for( int i = count - 1; i >= gap; --i ) groups[i + missing] = groups[i];
+        for( int i = gap; i != gap + missing; ++i ) groups[i] = 0;
+        return true;
+    }
+
+    // RFC 5952: lowercase, no leading zeros, the longest run of two or more zero
+    // groups( the first one on a tie ) becomes "::"
+    int FormatV6( quint16 const ( &groups )[8], char * out )
+    {
+        int best = -1, best_length = 1;
+        for( int i = 0; i < 8; ){
+            if( groups[i] != 0 ){
+                ++i;
+                continue;
+            }
+            int run = i;
+            while( run < 8 && groups[run] == 0 ) ++run;
+            if( run - i > best_length ){
+                best = i;
+                best_length = run - i;
+            }
+            i = run;
+        }
+        static char const digits[] = "0123456789abcdef";
+        char *cursor = out;
+        for( int i = 0; i < 8; ++i ){
+            if( i == best ){
+                *cursor++ = ':';
+                if( i == 0 ) *cursor++ = ':';
+                i += best_length - 1;
+                continue;
+            }
+            bool leading = true;
+            for( int shift = 12; shift >= 0; shift -= 4 ){
+                int const nibble = ( groups[i] >> shift ) & 0xf;
+                if( leading && nibble == 0 && shift != 0 ) continue;
+                leading = false;
+                *cursor++ = digits[nibble];
+            }
+            if( i != 7 ) *cursor++ = ':';
+        }
+        return static_cast<int>( cursor - out );
+    }
+}
+
+IpAddress::IpAddress(): high{ 0 }, low{ 0 }
+{
+}
+
+bool IpAddress::Parse( char const * text, int length, IpAddress & address )
+{
+    char const *end = text + length;
+    quint32 v4 = 0;
+    if( ParseV4( text, end, v4 ) ){
+        address.high = 0;
+        address.low = s_v4_prefix | v4;
+        return true;
+    }
+    quint16 groups[8] {};
+    if( !ParseV6( text, end, groups ) ) return false;
+    address.high = address.low = 0;
+    for( int i = 0; i != 4; ++i ) address.high = address.high << 16 | groups[i];
+    for( int i = 4; i != 8; ++i ) address.low = address.low << 16 | groups[i];
+    return true;
+}
+
+bool IpAddress::Parse( QString const & text, IpAddress & address )
+{
+    QByteArray const latin1 = text.trimmed().toLatin1();
+    return Parse( latin1.constData(), latin1.size(), address );
+}
+
+IpAddress IpAddress::FromBits( quint64 high, quint64 low )
+{
+    IpAddress address {};
+    address.high = high;
+    address.low = low;
+    return address;
+}
+
+bool IpAddress::IsV4() const
+{
+    return high == 0 && ( low >> 32 ) == ( s_v4_prefix >> 32 );
+}
+
+QString IpAddress::ToString() const
+{
+    if( IsV4() ){
+        return QString( "%1.%2.%3.%4" ).arg( low >> 24 & 0xff ).arg( low >> 16 & 0xff )
+                .arg( low >> 8 & 0xff ).arg( low & 0xff );
+    }
+    quint16 groups[8] {};
+    for( int i = 0; i != 4; ++i ){
+        groups[i] = static_cast<quint16>( high >> ( 48 - 16 * i ) );
+        groups[i + 4] = static_cast<quint16>( low >> ( 48 - 16 * i ) );
+    }
+    char buffer[48];
+    return QString::fromLatin1( buffer, FormatV6( groups, buffer ) );
+}
+
+quint64 IpAddress::High() const { return high; }
+quint64 IpAddress::Low() const { return low; }
+
+uint qHash( IpAddress const & address, uint seed )
+{
+    return qHash( address.High() ^ ( address.Low() * Q_UINT64_C( 0x9E3779B97F4A7C15 ) ), seed );
+}
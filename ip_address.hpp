@@ -0,0 +1,41 @@
+#ifndef IP_ADDRESS_HPP
+#define IP_ADDRESS_HPP
+
+#include <QString>
+#include <QtGlobal>
+
+// An IPv4 or IPv6 address parsed once into 128 bits, IPv4 as ::ffff:a.b.c.d. Two
+// addresses compare with two integer compares, and the order is numeric, so every
+// IPv4 address sorts together and 10.0.0.2 comes before 10.0.0.10.
+class IpAddress
+{
+public:
+    IpAddress();
+
+    // accepts dotted quads( leading zeros are decimal, 010.0.0.1 is 10.0.0.1 ) and
+    // RFC 4291 text, including "::" and an IPv4 tail. Link-local addresses with a zone
+    // ( fe80::1%lo0 ) can't be represented and are rejected
+    static bool Parse( char const * text, int length, IpAddress & address );
+    static bool Parse( QString const & text, IpAddress & address );
+    static IpAddress FromBits( quint64 high, quint64 low );
+
+    bool    IsV4() const;
+    // dotted quad, or RFC 5952 for IPv6, so equal addresses always print the same
+    QString ToString() const;
+    quint64 High() const;
+    quint64 Low() const;
+
+    bool operator==( IpAddress const & other ) const { return high == other.high && low == other.low; }
+    bool operator!=( IpAddress const & other ) const { return !( *this == other ); }
+    bool operator<( IpAddress const & other ) const {
+        return high < other.high || ( high == other.high && low < other.low );
+    }
+
+private:
+    quint64 high;
+    quint64 low;
+};
+
+uint qHash( IpAddress const & address, uint seed = 0 );
+
+#endif // IP_ADDRESS_HPP
@@ -0,0 +1,132 @@
+#include "json_stream_writer.hpp"
+#include <cstring>
+
+int const JsonStreamWriter::s_default_buffer_size = 64 * 1024;
+
+JsonStreamWriter::JsonStreamWriter( QIODevice & device, int buffer_size ): device( device ),
+    buffer{}, capacity{ buffer_size }, has_items{}, after_key{ false }, ok{ true }, written{ 0 }
+{
+    buffer.reserve( capacity );
+}
+
+void JsonStreamWriter::BeginObject() { Open( '{' ); }
+void JsonStreamWriter::EndObject() { Close( '}' ); }
+void JsonStreamWriter::BeginArray() { Open( '[' ); }
+void JsonStreamWriter::EndArray() { Close( ']' ); }
+
+void JsonStreamWriter::Key( char const * key )
+{
+    BeforeValue();
+    Append( "\"", 1 );
+    Append( key, static_cast<int>( std::strlen( key ) ) );
+    Append( "\": ", 3 );
+    after_key = true;
+}
+
+void JsonStreamWriter::Value( QString const & value )
+{
+    Value( value.toUtf8() );
+}
+
+void JsonStreamWriter::Value( QByteArray const & utf8 )
+{
+    BeforeValue();
+    Append( "\"", 1 );
+    AppendEscaped( utf8.constData(), utf8.size() );
+    Append( "\"", 1 );
+}
+
+bool JsonStreamWriter::Finish()
+{
+    Q_ASSERT( has_items.empty() );
+    Append( "\n", 1 );
+    Flush();
+    return ok;
+}
+
+qint64 JsonStreamWriter::BytesWritten() const { return written + buffer.size(); }
+
+// a value inside an array, or a key inside an object, gets a separator and its own line
+void JsonStreamWriter::BeforeValue()
+{
+    if( after_key ){
+        after_key = false;
+        return;
+    }
+    if( has_items.empty() ) return;
+    if( has_items.back() ) Append( ",", 1 );
+    has_items.back() = true;
+    NewLine( has_items.size() );
+}
+
+void JsonStreamWriter::Open( char bracket )
+{
+    BeforeValue();
+    Append( &bracket, 1 );
+    has_items.push_back( false );
+}
+
+void JsonStreamWriter::Close( char bracket )
+{
+    Q_ASSERT( !has_items.empty() );
+    has_items.pop_back();
+    // empty or not, Qt puts the closing bracket on a line of its own: "[\n    ]"
+    NewLine( has_items.size() );
+    Append( &bracket, 1 );
+}
+
+void JsonStreamWriter::NewLine( std::size_t depth )
+{
+    static char const spaces[] = "                                ";
+    Append( "\n", 1 );
+    for( std::size_t indent = depth * 4; indent != 0; ){
+        int const chunk = static_cast<int>( qMin<std::size_t>( indent, sizeof( spaces ) - 1 ) );
+        Append( spaces, chunk );
+        indent -= static_cast<std::size_t>( chunk );
+    }
+}
+
+void JsonStreamWriter::Append( char const * data, int length )
+{
+    if( buffer.size() + length > capacity ) Flush();
+    if( length > capacity ){ // bigger than the whole buffer, skip it
+        ok = ok && device.write( data, length ) == length;
+        written += length;
+        return;
+    }
+    buffer.append( data, length );
+}
+
+void JsonStreamWriter::AppendEscaped( char const * data, int length )
+{
+    static char const hex[] = "0123456789abcdef";
+    int plain = 0; // start of the run that needs no escaping
+    for( int i = 0; i != length; ++i ){
+        uchar const c = static_cast<uchar>( data[i] );
+        if( c >= 0x20 && c != '"' && c != '\\' ) continue;
+        Append( data + plain, i - plain );
+        plain = i + 1;
+        switch( c ){
+        case '"': Append( "\\\"", 2 ); break;
+        case '\\': Append( "\\\\", 2 ); break;
+        case '\b': Append( "\\b", 2 ); break;
+        case '\f': Append( "\\f", 2 ); break;
+        case '\n': Append( "\\n", 2 ); break;
+        case '\r': Append( "\\r", 2 ); break;
+        case '\t': Append( "\\t", 2 ); break;
+        default: {
+            char const escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+            Append( escaped, 6 );
+        }
+        }
+    }
+    Append( data + plain, length - plain );
+}
+
+void JsonStreamWriter::Flush()
+{
+    if( buffer.isEmpty() ) return;
+    ok = ok && device.write( buffer ) == buffer.size();
+    written += buffer.size();
+    buffer.resize( 0 );
+}
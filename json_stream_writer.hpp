@@ -0,0 +1,49 @@
+#ifndef JSON_STREAM_WRITER_HPP
+#define JSON_STREAM_WRITER_HPP
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <vector>
+
+// Writes JSON straight to a device through a fixed size buffer, laid out like
+// QJsonDocument::Indented. Nothing of the document is kept beyond that buffer, so
+// memory stays flat however large the document gets. Well-formedness is up to the
+// caller: every Key() inside an object is followed by exactly one value.
+class JsonStreamWriter
+{
+public:
+    explicit JsonStreamWriter( QIODevice & device, int buffer_size = s_default_buffer_size );
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    void Key( char const * key ); // plain ASCII, written as is
+    void Value( QString const & value );
+    void Value( QByteArray const & utf8 );
+    // flushes what is left, false if any write to the device failed
+    bool Finish();
+    qint64 BytesWritten() const;
+
+    static int const s_default_buffer_size;
+
+private:
+    void BeforeValue();
+    void Open( char bracket );
+    void Close( char bracket );
+    void NewLine( std::size_t depth );
+    void Append( char const * data, int length );
+    void AppendEscaped( char const * data, int length );
+    void Flush();
+
+    QIODevice           &device;
+    QByteArray           buffer;
+    int                  capacity;
+    std::vector<bool>    has_items; // one per open object/array
+    bool                 after_key;
+    bool                 ok;
+    qint64               written;
+};
+
+#endif // JSON_STREAM_WRITER_HPP
@@ -1,9 +1,22 @@
 #include "mainwindow.h"
+#include "batch_runner.hpp"
+#include "statistics.hpp"
 #include <QApplication>
+#include <QCoreApplication>
 
 int main(int argc, char *argv[])
 {
+    // HFM_STATISTICS=0 turns the I/O instrumentation off
+    Statistics::SetEnabled( qgetenv( "HFM_STATISTICS" ) != "0" );
+
+    if( BatchRunner::IsRequested( argc, argv ) ){
+        QCoreApplication a(argc, argv);
+        return BatchRunner::Run( QCoreApplication::arguments() );
+    }
+
     QApplication a(argc, argv);
+    QApplication::setOrganizationName( "HostsFileManager" );
+    QApplication::setApplicationName( "HostsFileManager" );
 
     QApplication::setQuitOnLastWindowClosed( false );
 
@@ -5,14 +5,10 @@
 #include <QDebug>
 #include <QFile>
 #include <QFileDialog>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
+#include <QFileInfo>
 #include <QMap>
 #include <QMessageBox>
-#include <QRegExp>
 #include <QStringList>
-#include <QTextStream>
 #include <QVariant>
 #include <QGridLayout>
 #include <QLabel>
@@ -21,19 +17,53 @@
 #include <QPushButton>
 #include <QGroupBox>
 #include <QComboBox>
-#include <QDateTime>
+#include <QSettings>
+#include <QInputDialog>
+#include <QProgressBar>
+#include <QStatusBar>
+#include <QTimer>
+#include <QtConcurrent>
 #include "add_alias_dialog.hpp"
+#include "domain_browser_dialog.hpp"
+#include "statistics.hpp"
+#include "statistics_dialog.hpp"
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::MainWindow), signal_mapper( nullptr )
+    ui(new Ui::MainWindow), signal_mapper( nullptr ), config_writer( new ConfigWriter( this ) ),
+    sync_coalescer( nullptr ), file_watcher( new HostsFileWatcher( this ) ), last_write_job( 0 ),
+    write_in_flight( false ), dns_responder( nullptr ), config_loader( nullptr ), config_reloader( nullptr ), load_progress( nullptr ),
+    reload_version( 0 ), reload_again( false )
 {
+    // nothing in here may depend on the config's size, it loads once the window is up
+    ScopedTimer const timer{ Statistics::Startup };
     ui->setupUi(this);
+    dns_responder = new DnsResponder( dns_table );
+
+    int const sync_window = qEnvironmentVariableIsSet( "HFM_SYNC_WINDOW_MS" ) ?
+                qEnvironmentVariableIntValue( "HFM_SYNC_WINDOW_MS" ) : WriteCoalescer::s_default_window_ms;
+    sync_coalescer = new WriteCoalescer( sync_window, this );
+
+    QObject::connect( sync_coalescer, &WriteCoalescer::Flush, this, &MainWindow::OnSyncFlush );
+    QObject::connect( config_writer, &ConfigWriter::JobFinished, this, &MainWindow::OnWriteFinished );
+    QObject::connect( config_writer, &ConfigWriter::JobFailed, this, &MainWindow::OnWriteFailed );
+    QObject::connect( file_watcher, &HostsFileWatcher::HostsEntriesChanged, this, &MainWindow::OnHostsEntriesChanged );
+    QObject::connect( file_watcher, &HostsFileWatcher::ConfigFileChanged, this, &MainWindow::OnConfigFileChanged );
+    QObject::connect( qApp, &QCoreApplication::aboutToQuit, this, &MainWindow::OnAboutToQuit );
+
+    config_loader = new QFutureWatcher<LoadedConfig>( this );
+    QObject::connect( config_loader, &QFutureWatcher<LoadedConfig>::finished, this, &MainWindow::OnConfigLoaded );
+    blocklist_loader = new QFutureWatcher<ImportedLists>( this );
+    QObject::connect( blocklist_loader, &QFutureWatcher<ImportedLists>::finished, this, &MainWindow::OnBlocklistsImported );
+    config_reloader = new QFutureWatcher<LoadedConfig>( this );
+    QObject::connect( config_reloader, &QFutureWatcher<LoadedConfig>::finished, this, &MainWindow::OnConfigReloaded );
 
     CreateMenus();
     CreateSystemTrayIcon();
-    ReadConfigFile();
+    // pinned and recent domains come from the settings, so the menu is complete right away;
+    // it is enabled once there are aliases to point them to
     MapAliasesToActionSignals();
+    SetStoreActionsEnabled( false );
 
     QObject::connect( tray_icon, SIGNAL(activated(QSystemTrayIcon::ActivationReason)),
                       this, SLOT(OnTrayIconActivated(QSystemTrayIcon::ActivationReason)) );
@@ -41,15 +71,122 @@ MainWindow::MainWindow(QWidget *parent) :
     setWindowTitle( s_title );
     setWindowIcon( QIcon( ":/image/images/logo.png" ) );
     setMaximumSize( QSize( 400, 300 ));
+    // once the event loop runs, so the window is painted before any first run dialog
+    QTimer::singleShot( 0, this, &MainWindow::ReadConfigFile );
 }
 
 QString MainWindow::s_title = "Hosts File Manager";
 QString MainWindow::s_config_filename = "./config.json";
+int const MainWindow::s_max_recent_domains = 10;
+int const MainWindow::s_max_alias_choices = 50;
+
+// how long quitting may wait for the last writes to reach the disk
+static unsigned long const s_shutdown_timeout_ms = 10000;
 
 MainWindow::~MainWindow()
 {
+    // its thread reads dns_table, which goes away with us
+    delete dns_responder;
     delete ui;
-    SyncConfigFile();
+}
+
+void MainWindow::OnAboutToQuit()
+{
+    // every change is in the journal already, only pending writes are waited for
+    sync_coalescer->FlushNow();
+    config_writer->WaitForIdle( s_shutdown_timeout_ms );
+    config_writer->Shutdown();
+}
+
+void MainWindow::OnSyncFlush( int targets )
+{
+    ConfigState state = CurrentState();
+    // later changes go to a new journal file, the ones up to now are folded into config.json
+    if( targets & ConfigWriter::ConfigFile ) state.journal_generation = journal.Rotate();
+    quint64 const job_id = config_writer->Enqueue( state, targets );
+    if( job_id == 0 ) return;
+    // our own writes must not come back as external changes
+    if( !write_in_flight ) file_watcher->Suspend();
+    write_in_flight = true;
+    last_write_job = job_id;
+}
+
+void MainWindow::EndWrite( quint64 job_id )
+{
+    if( !write_in_flight || job_id != last_write_job ) return;
+    write_in_flight = false;
+    file_watcher->Resume();
+}
+
+void MainWindow::OnWriteFinished( quint64 job_id )
+{
+    EndWrite( job_id );
+}
+
+void MainWindow::OnWriteFailed( quint64 job_id, QString const & error )
+{
+    EndWrite( job_id );
+    SHOW_CMESSAGE( error );
+}
+
+void MainWindow::OnHostsEntriesChanged( HostsMapping const & added, HostsMapping const & removed )
+{
+    // the hosts file already says this, only config.json has to catch up
+    if( store.MergeHostsEntries( added, removed ) != 0 ) SyncConfigFile();
+}
+
+void MainWindow::OnConfigFileChanged()
+{
+    // one reload at a time, a change seen meanwhile is picked up by reloading once more
+    if( config_reloader->isRunning() ){
+        reload_again = true;
+        return;
+    }
+    // the reload replays the journal on top of the edited config.json, so what this session
+    // changed has to be in it first
+    QString error {};
+    if( !journal.Append( store.TakeJournalRecords(), error ) ){
+        SHOW_CMESSAGE( "config.json was changed by another program, but the pending changes could not be "
+                       "journaled( " + error + " ). Keeping them instead of reloading" );
+        CompactConfigFile();
+        return;
+    }
+    reload_again = false;
+    reload_version = store.Publish()->version;
+    statusBar()->showMessage( "Reloading " + s_config_filename + "..." );
+
+    QString const config_path = s_config_filename;
+    config_reloader->setFuture( QtConcurrent::run( [config_path]{
+        LoadedConfig loaded{ std::make_shared<AliasStore>(), QString{}, QStringList{} };
+        // the snapshot is the writer's to refresh, with the next config.json it writes
+        loaded.store->Load( config_path, loaded.error, loaded.warnings, AliasStore::SnapshotMode::ReadOnly );
+        return loaded;
+    }));
+}
+
+void MainWindow::OnConfigReloaded()
+{
+    LoadedConfig const loaded = config_reloader->result();
+    statusBar()->clearMessage();
+    // a change made meanwhile is journaled, but maybe after the reload replayed the journal
+    if( reload_again || store.Publish()->version != reload_version ){
+        OnConfigFileChanged();
+        return;
+    }
+    if( !loaded.error.isEmpty() ){
+        SHOW_CMESSAGE( "config.json was changed by another program and could not be reloaded: " + loaded.error );
+        return;
+    }
+    for( auto const & warning: loaded.warnings ) SHOW_CMESSAGE( warning );
+
+    bool const moved_hosts_file = loaded.store->HostsFilePath() != store.HostsFilePath();
+    store = std::move( *loaded.store );
+    store.Publish();
+    journal.Open( s_config_filename, store.JournalGeneration() + 1, store.JournalBytes() );
+    store.SetJournaling( true );
+    FixUnusableAddresses();
+    if( moved_hosts_file ) file_watcher->Watch( store.HostsFilePath(), s_config_filename );
+    // config.json is the source of truth for the hosts file
     SyncConfigWithHostsFile();
 }
 
@@ -59,18 +196,38 @@ void MainWindow::CreateMenus()
     add_alias_action = new QAction( "Add alias", this );
     exit_action = new QAction( "&Exit", this );
 
+    browse_domains_action = new QAction( "&Browse domains...", this );
+    statistics_action = new QAction( "&Statistics", this );
+    import_action = new QAction( "&Import blocklists...", this );
+    dns_action = new QAction( "Local &DNS responder", this );
+    dns_action->setCheckable( true );
+
     point_menu = new QMenu( "&Point to", this );
+    profiles_menu = new QMenu( "P&rofiles", this );
+    save_profile_action = new QAction( "&Save current as profile...", this );
     QObject::connect( exit_action, SIGNAL(triggered(bool)), qApp, SLOT(quit()) );
 
     QMenu *main_menu = menuBar()->addMenu( "&Menu" );
     main_menu->addMenu( point_menu );
+    main_menu->addMenu( profiles_menu );
     main_menu->addAction( configure_action );
     main_menu->addAction( add_alias_action );
+    main_menu->addAction( import_action );
+    main_menu->addAction( dns_action );
+    main_menu->addAction( statistics_action );
     main_menu->addSeparator();
     main_menu->addAction( exit_action );
 
     QObject::connect( configure_action, SIGNAL(triggered(bool)), this, SLOT( OnConfigureActionTriggered() ) );
     QObject::connect( add_alias_action, SIGNAL(triggered(bool)), this, SLOT(OnAddAliasTriggered()) );
+    QObject::connect( browse_domains_action, SIGNAL(triggered(bool)), this, SLOT(OnBrowseDomainsTriggered()) );
+    QObject::connect( statistics_action, SIGNAL(triggered(bool)), this, SLOT(OnStatisticsTriggered()) );
+    QObject::connect( import_action, SIGNAL(triggered(bool)), this, SLOT(OnImportBlocklistsTriggered()) );
+    QObject::connect( dns_action, SIGNAL(toggled(bool)), this, SLOT(OnDnsResponderToggled(bool)) );
+    QObject::connect( save_profile_action, SIGNAL(triggered(bool)), this, SLOT(OnSaveProfileTriggered()) );
+    QObject::connect( profiles_menu, SIGNAL(triggered(QAction*)), this, SLOT(OnProfileTriggered(QAction*)) );
+    // any edit may leave the active profile behind, so the check marks are redone on every show
+    QObject::connect( profiles_menu, &QMenu::aboutToShow, this, &MainWindow::RebuildProfilesMenu );
 }
 
 void MainWindow::OnConfigureActionTriggered()
@@ -84,21 +241,24 @@ void MainWindow::OnConfigureActionTriggered()
     dialog_layout->addWidget( domain_name_line_edit, 0, 1 );
     dialog_layout->addWidget( new QLabel( "Select existing aliases" ), 1, 0 );
 
+    QLineEdit *alias_search_line_edit = new QLineEdit();
+    alias_search_line_edit->setPlaceholderText( "Search by name, IP or domain" );
     QComboBox *alias_combo_box = new QComboBox();
-    QStringList list {};
-    for( auto & key: aliases.keys() ){
-        list << key + tr( " | %1" ).arg( aliases[ key ].Address() );
-    }
-    alias_combo_box->addItems( list );
-    dialog_layout->addWidget( alias_combo_box, 1, 1 );
+    FillAliasComboBox( alias_combo_box, QString{} );
+    QObject::connect( alias_search_line_edit, &QLineEdit::textChanged, [this, alias_combo_box]( QString const & text ){
+        FillAliasComboBox( alias_combo_box, text.trimmed() );
+    });
+    dialog_layout->addWidget( alias_search_line_edit, 1, 1 );
+    dialog_layout->addWidget( alias_combo_box, 2, 1 );
 
     QPushButton *ok_button = new QPushButton( tr( "OK" ) ),
             *add_alias_button = new QPushButton( "Add new alias" );
     QObject::connect( add_alias_button, &QPushButton::clicked, [&]() mutable {
-        add_alias_dialog *new_dialog = new add_alias_dialog( aliases, configure_dialog );
+        add_alias_dialog *new_dialog = new add_alias_dialog( store.Snapshot(), configure_dialog );
         if( new_dialog->exec() == QDialog::Accepted ){
+            store.AddAlias( new_dialog->Label(), new_dialog->Address() );
             QString const new_item { new_dialog->Label() + " | " + new_dialog->Ip() };
-            alias_combo_box->addItem( new_item );
+            alias_combo_box->addItem( new_item, new_dialog->Label() );
             SyncConfigFile();
             QMessageBox::information( configure_dialog, s_title, "New alias added, check the list now" );
         }
@@ -112,33 +272,32 @@ void MainWindow::OnConfigureActionTriggered()
             SHOW_CMESSAGE( "the domain name cannot be left empty" );
             return;
         }
-        if( domain_names.find( domain_name ) != domain_names.end() ){
-            SHOW_CMESSAGE( "The domain name already exist" );
-            return;
-        }
-        QStringList const split = domain_name.split( QChar( '|' ) );
-        QString label, ip;
-
-        if( split.length() > 1 ){
-            label = split[0].trimmed();
-            ip = split[1].trimmed();
-            qDebug() << "Label:" << label << ", IP:" << ip;
+        QString const alias_name = alias_combo_box->currentData().toString();
+        // "*.staging.corp" moves the whole subtree in one go
+        if( DomainTrie::IsWildcard( domain_name ) ){
+            if( !store.PointSubtreeTo( domain_name, alias_name ) ){
+                SHOW_CMESSAGE( "Select an alias for the rule to point to" );
+                return;
+            }
+        } else {
+            if( store.HasDomain( domain_name ) ){
+                SHOW_CMESSAGE( "The domain name already exist" );
+                return;
+            }
+            if( !store.PointDomainTo( domain_name, alias_name ) ){
+                SHOW_CMESSAGE( "Select an alias for the domain name to point to" );
+                return;
+            }
+            NoteRecentDomain( domain_name );
         }
 
-        domain_names.insert( domain_name );
-
-        QAction *domain_action = new QAction( domain_name );
-        QObject::connect( domain_action, SIGNAL(triggered(bool)), signal_mapper, SLOT( map() ) );
-        signal_mapper->setMapping( domain_action, domain_name );
-        point_menu->addAction( domain_action );
-
         configure_dialog->accept();
         SyncConfigFile();
         SyncConfigWithHostsFile();
     });
 
-    dialog_layout->addWidget( add_alias_button, 2, 0 );
-    dialog_layout->addWidget( ok_button, 2, 1 );
+    dialog_layout->addWidget( add_alias_button, 3, 0 );
+    dialog_layout->addWidget( ok_button, 3, 1 );
 
     configure_dialog->setLayout( dialog_layout );
     configure_dialog->setMaximumSize( QSize( 150, 200 ) );
@@ -147,8 +306,9 @@ void MainWindow::OnConfigureActionTriggered()
 
 void MainWindow::OnAddAliasTriggered()
 {
-    add_alias_dialog *new_dialog = new add_alias_dialog( aliases, this );
-    new_dialog->exec();
+    add_alias_dialog *new_dialog = new add_alias_dialog( store.Snapshot(), this );
+    if( new_dialog->exec() != QDialog::Accepted ) return;
+    store.AddAlias( new_dialog->Label(), new_dialog->Address() );
     SyncConfigFile();
 }
 
@@ -162,7 +322,11 @@ void MainWindow::CreateSystemTrayIcon()
     tray_icon_menu->addSeparator();
 
     tray_icon_menu->addMenu( point_menu );
+    tray_icon_menu->addMenu( profiles_menu );
     tray_icon_menu->addAction( configure_action );
+    tray_icon_menu->addAction( import_action );
+    tray_icon_menu->addAction( dns_action );
+    tray_icon_menu->addAction( statistics_action );
 
     tray_icon_menu->addSeparator();
 
@@ -182,7 +346,6 @@ void MainWindow::closeEvent( QCloseEvent *event )
 
 void MainWindow::OnTrayIconActivated( QSystemTrayIcon::ActivationReason reason )
 {
-    qDebug() << "We are here";
     switch( reason ){
     case QSystemTrayIcon::DoubleClick:
     case QSystemTrayIcon::Trigger:
@@ -194,8 +357,8 @@ void MainWindow::OnTrayIconActivated( QSystemTrayIcon::ActivationReason reason )
 
 void MainWindow::ReadConfigFile()
 {
-    QFile config_file { s_config_filename };
-    if( !config_file.exists() ){ // take us through creating it
+    QString host_file {};
+    if( !QFile::exists( s_config_filename ) ){ // take us through creating it
         auto res = QMessageBox::information( this, s_title,
                                              "The configuration file where all meta-data resides cannot "
                                              "be found, I'd like to work you through how to create a "
@@ -206,234 +369,220 @@ void MainWindow::ReadConfigFile()
         } else {
             QString const default_path = "C:\\Windows\\System32\\Drivers\\etc";
             QMessageBox::information( this, s_title, "Let us locate where the host file is." );
-            QString const host_file = QFileDialog::getOpenFileName( this, "Hosts file name", default_path );
+            host_file = QFileDialog::getOpenFileName( this, "Hosts file name", default_path );
             if( host_file.isNull() ){
                 SHOW_CMESSAGE( "Unable to read the host file. Closing up" );
                 std::exit( -1 );
             }
-            QMap<QString, list_str_pair> mapping {};
-            if( !ReadHostsFile( host_file, mapping ) ){
-                std::exit( -1 );
-            }
-            WriteHostFileToConfigFile( config_file.fileName(), host_file, mapping );
         }
     }
-    if( !config_file.open( QIODevice::ReadOnly ) ){
-        SHOW_CMESSAGE( config_file.errorString() );
-        std::exit( -1 );
-    }
-    QJsonObject doc_root {};
-    {
-        QJsonDocument config_json_doc{ QJsonDocument::fromJson( config_file.readAll() ) };
-        config_file.close();
-        if( config_json_doc.isNull() ){
-            SHOW_CMESSAGE( "The configuration file has been tampered with.\n"
-                           "Please remove it and restart the application." );
-            std::exit( -1 );
-        }
-        if( !config_json_doc.isObject() ){
-            SHOW_CMESSAGE( "The root of the configuration must be an object {} file." );
-            std::exit( -1 );
+
+    load_progress = new QProgressBar( this );
+    load_progress->setRange( 0, 0 ); // busy, the load doesn't know its own length up front
+    load_progress->setMaximumWidth( 120 );
+    statusBar()->addPermanentWidget( load_progress );
+    statusBar()->showMessage( "Loading " + s_config_filename + "..." );
+    tray_icon->setToolTip( s_title + " - loading the configuration..." );
+
+    QString const config_path = s_config_filename;
+    config_loader->setFuture( QtConcurrent::run( [config_path, host_file]{
+        LoadedConfig loaded{ std::make_shared<AliasStore>(), QString{}, QStringList{} };
+        if( !host_file.isEmpty() && !AliasStore::ImportHostsFile( host_file, config_path, loaded.error ) ){
+            return loaded;
         }
-        doc_root = config_json_doc.object();
-    }
-    // if we are here, we have a valid document root
-    if( !doc_root.contains( "host" ) ){
-        SHOW_CMESSAGE( "The location of the hosts file could not be obtained" );
-        std::exit( -1 );
-    }
-    hosts_file_path = doc_root.value( "host" ).toString();
-    Q_ASSERT( !hosts_file_path.isNull() );
+        loaded.store->Load( config_path, loaded.error, loaded.warnings );
+        return loaded;
+    }));
+}
 
-    if( !doc_root.contains( "aliases" ) || !doc_root.value( "aliases" ).isArray() ){
-        SHOW_CMESSAGE( "Unable to find ( a valid ) key 'aliases'" );
+void MainWindow::OnConfigLoaded()
+{
+    LoadedConfig const loaded = config_loader->result();
+    statusBar()->removeWidget( load_progress );
+    load_progress->deleteLater();
+    load_progress = nullptr;
+    tray_icon->setToolTip( s_title );
+    if( !loaded.error.isEmpty() ){
+        SHOW_CMESSAGE( loaded.error );
         std::exit( -1 );
     }
-
-    QJsonArray json_alias_values( doc_root.value( "aliases" ).toArray() );
-    for( auto const &alias : json_alias_values ){
-        if( !alias.isObject() ){
-            SHOW_CMESSAGE( "Invalid alias found" );
-            continue;
-        }
-        QJsonObject current_alias = alias.toObject();
-        Alias value_alias { current_alias.value( "name" ).toString(),
-                    current_alias.value( "ip" ).toString() };
-        QJsonArray pointing_to_domains = current_alias.value( "pointing_to" ).toArray();
-
-        QString domain_name;
-        for( auto const & domain: pointing_to_domains ) {
-            domain_name = domain.toString();
-            value_alias.InsertDomainName( domain_name );
-            auto result = domain_names.insert( domain_name );
-            if( !result.second ){
-                qDebug() << "Duplicate domain name found:" << domain_name << ", ignoring.";
-            }
-        }
-        if( aliases.contains( value_alias.Name() ) ){
-            SHOW_CMESSAGE( tr( "In the aliases, '%1' already exist." ).arg( value_alias.Name() ) );
-            continue;
-        }
-        aliases.insert( value_alias.Name(), value_alias );
-    }
+    for( auto const & warning: loaded.warnings ) SHOW_CMESSAGE( warning );
+
+    // a move, however big the config: the GUI thread never walks it
+    store = std::move( *loaded.store );
+    store.Publish();
+    journal.Open( s_config_filename, store.JournalGeneration() + 1, store.JournalBytes() );
+    store.SetJournaling( true );
+    FixUnusableAddresses();
+    // fold what the last run journaled into config.json, off the GUI thread
+    if( store.JournalGeneration() != 0 ) CompactConfigFile();
+
+    file_watcher->Watch( store.HostsFilePath(), s_config_filename );
+    SetStoreActionsEnabled( true );
+    statusBar()->showMessage( tr( "%1 aliases, %2 domains" ).arg( store.Aliases().size() )
+                              .arg( store.DomainOwners().size() ), 5000 );
+    // starts it through OnDnsResponderToggled
+    dns_action->setChecked( QSettings{}.value( "dns/enabled", false ).toBool() );
 }
 
-bool MainWindow::ReadHostsFile( QString const &host_filename, QMap<QString, list_str_pair> & mapping )
+void MainWindow::FixUnusableAddresses()
 {
-    QFile file{ host_filename };
-    if( !file.exists() || !file.open( QIODevice::ReadOnly ) ){
-        return false;
+    QStringList names {};
+    for( auto const & alias: store.Aliases() ){
+        if( !alias.HasAddress() ) names.append( alias.Name() );
     }
-    QTextStream file_reader_stream{ &file };
-    QString current_line {};
-    while( !file_reader_stream.atEnd() ){
-        current_line = file_reader_stream.readLine().trimmed();
-
-        //ignore empty lines
-        if( current_line.isEmpty() || current_line.isNull() ) continue;
-        if( current_line.startsWith( QChar( '#' ) ) ) continue; // ignore comments
-
-        // the hosts file are mapped like so: IP_Address:HostName pairs, such that they're separated by
-        // at least a single whitespace
-        QStringList splitted_string = current_line.split( QRegExp( "\\s+" ) );
-        if( splitted_string.size() > 1 ){
-            mapping[splitted_string[0]].append( splitted_string[1] );
+    bool fixed = false;
+    for( auto const & name: names ){
+        QString text = store.Aliases()[name].UnparsedAddress();
+        IpAddress address {};
+        bool accepted = true;
+        // asked again until it parses; cancelling keeps the alias as it is
+        while( accepted && !IpAddress::Parse( text, address ) ){
+            text = QInputDialog::getText( this, s_title, tr( "'%1' can't be used as the address of the alias '%2'. "
+                                                             "New address" ).arg( text, name ),
+                                          QLineEdit::Normal, text, &accepted ).trimmed();
         }
+        if( accepted && store.SetAliasAddress( name, address ) ) fixed = true;
+    }
+    if( fixed ){
+        SyncConfigFile();
+        SyncConfigWithHostsFile();
     }
-    file.close();
-    return true;
 }
 
-void MainWindow::WriteHostFileToConfigFile(const QString &config_path, const QString &hosts_file_path,
-                                            const QMap<QString, list_str_pair> &mappings )
+void MainWindow::SetStoreActionsEnabled( bool enabled )
 {
-    QFile config_file( config_path );
-    if( !config_file.open( QIODevice::WriteOnly ) ){
-        QMessageBox::critical( this, s_title, config_file.errorString() );
-        std::exit( -1 );
+    for( QAction *action: { configure_action, add_alias_action, browse_domains_action, import_action,
+                            save_profile_action, dns_action } ){
+        action->setEnabled( enabled );
     }
-    using Pair = QPair<QString, QJsonValue>;
-    unsigned int i = 0;
-
-    QJsonArray aliases {};
-    qDebug() << mappings.keys().length();
-
-    for( auto const & key: mappings.keys() ){
-        list_str_pair const & values = mappings[ key ];
-        QJsonArray pointing_to_array {};
-        for( auto const & value : values )
-            pointing_to_array.append( value );
-
-        aliases.append( QJsonObject( { Pair( "ip", key ),
-                                       Pair( "name", tr( "untitled_%1" ).arg( i ) ),
-                                       Pair( "pointing_to", pointing_to_array )
-                                     }));
-        ++i;
-    }
-
-    QJsonObject document_root {};
-    document_root.insert( "host", hosts_file_path );
-    document_root.insert( "aliases", aliases );
+    point_menu->setEnabled( enabled );
+    profiles_menu->setEnabled( enabled );
+}
 
-    QJsonDocument json_document{ document_root };
-    config_file.write( json_document.toJson() );
-    config_file.close();
+ConfigState MainWindow::CurrentState() const
+{
+    return store.State( s_config_filename );
 }
 
 void MainWindow::SyncConfigFile()
 {
-    QFile config_file( s_config_filename );
-    if( !config_file.open( QIODevice::WriteOnly ) ){
-        QMessageBox::critical( this, s_title, config_file.errorString() );
-        std::exit( -1 );
+    QString error {};
+    bool const journaled = journal.Append( store.TakeJournalRecords(), error );
+    // a journal that can't be written is no worse than before it existed: rewrite the lot
+    if( !journaled ){
+        statusBar()->showMessage( "Unable to journal the change( " + error + " ), rewriting config.json instead", 10000 );
     }
-    using Pair = QPair<QString, QJsonValue>;
-    QJsonArray pointer_array {};
-    for( auto const & key: aliases.keys() ){
-        Alias &alias = aliases[key];
-        QJsonArray array {};
-        for( auto const &a: alias.GetDomainNames() ){
-            array.append( a );
-        }
-        pointer_array.append( QJsonObject( { Pair( "ip", alias.Address() ),
-                                       Pair( "name", alias.Name() ),
-                                       Pair( "pointing_to", array )
-                                     }));
-    }
-
-    QJsonObject document_root {};
-    document_root.insert( "aliases", pointer_array );
-    document_root.insert( "host", hosts_file_path );
+    if( !journaled || journal.UncompactedBytes() >= ConfigJournal::s_compact_threshold ) CompactConfigFile();
+    store.Publish();
+    SyncDnsTable();
+}
 
-    QJsonDocument json_document{ document_root };
-    config_file.write( json_document.toJson() );
-    config_file.close();
+void MainWindow::CompactConfigFile()
+{
+    sync_coalescer->MarkDirty( ConfigWriter::ConfigFile );
 }
 
 void MainWindow::SyncConfigWithHostsFile()
 {
-    QFile file{ hosts_file_path };
-    if( !file.exists() ){
-        if( !file.open( QIODevice::WriteOnly ) ){
-            SHOW_CMESSAGE( file.errorString() );
-            return;
-        }
-    }
-    if( !file.open( QIODevice::WriteOnly ) ){
-        SHOW_CMESSAGE( file.errorString() );
-        return;
-    }
+    sync_coalescer->MarkDirty( ConfigWriter::HostsFile );
+    store.Publish();
+    SyncDnsTable();
+}
 
-    QTextStream file_writer{ &file };
-    QString const default_strings = "# Copyright (c) 1993-2009 Microsoft Corp.\n#\n\
-# This is a sample HOSTS file used by Microsoft TCP/IP for Windows.\n\
-#\n\
-# This file contains the mappings of IP addresses to host names. Each\n\
-# entry should be kept on an individual line. The IP address should\n\
-# be placed in the first column followed by the corresponding host name.\n\
-# The IP address and the host name should be separated by at least one\n\
-# space.\n\
-#\n\
-# Additionally, comments (such as these) may be inserted on individual\n\
-# lines or following the machine name denoted by a '#' symbol.\n\
-#\n\
-# For example:\n\
-#\n\
-#      102.54.94.97     rhino.acme.com          # source server\n\
-#       38.25.63.10     x.acme.com              # x client host\n\
-\n\
-# localhost name resolution is handled within DNS itself.\n\
-#	127.0.0.1       localhost\n\
-#	::1             localhost";
-    file_writer << default_strings << "\n\n";
-    file_writer << "# Last sync date/time " << QDateTime::currentDateTime().toString() << "\n\n";
-
-    for( auto const &key: aliases.keys() ){
-        Alias &alias = aliases[key];
-        if( alias.IsEmptyDomain() ) continue;
-
-        file_writer << "# Alias name: " << alias.Name() << "\n";
-        for( auto &domain_name : alias.GetDomainNames() ){
-            file_writer << "\t" << alias.Address() << "\t\t" << domain_name << "\n";
-        }
-        file_writer << "\n";
-    }
-    file.close();
+void MainWindow::SyncDnsTable()
+{
+    // only aliases whose revision moved are looked at, a repoint costs what it touched
+    if( dns_responder->IsRunning() ) dns_table.Sync( store.Snapshot() );
 }
 
 void MainWindow::MapAliasesToActionSignals()
 {
     if( !signal_mapper ) signal_mapper = new QSignalMapper( this );
-    for( auto const & key : aliases.keys() ){
-        auto alias = aliases.value( key );
-        for( auto const & domain: alias.GetDomainNames() ){
-            QAction *action = new QAction( domain );
+    QObject::connect( signal_mapper, SIGNAL( mapped(QString)), this, SLOT(OnActionMapped(QString)) );
+
+    QSettings settings {};
+    recent_domains = settings.value( "recent_domains" ).toStringList();
+    pinned_domains = settings.value( "pinned_domains" ).toStringList();
+    RebuildPointMenu();
+}
+
+// only pinned and recently pointed domains get an action, everything else is one
+// "Browse domains..." away, so building the menu doesn't depend on the config's size
+void MainWindow::RebuildPointMenu()
+{
+    ScopedTimer const timer{ Statistics::MenuBuild };
+    // the action being rebuilt from may still be emitting, so don't delete it under its feet
+    for( QAction *action: point_menu->actions() ){
+        point_menu->removeAction( action );
+        if( action->parent() == point_menu ) action->deleteLater();
+    }
+    point_menu->addAction( browse_domains_action );
+
+    auto add_domains = [this]( QStringList const & domains ){
+        if( domains.isEmpty() ) return;
+        point_menu->addSeparator();
+        for( auto const & domain: domains ){
+            QAction *action = new QAction( domain, point_menu );
             QObject::connect( action, SIGNAL(triggered(bool)), signal_mapper, SLOT( map() ) );
             point_menu->addAction( action );
             signal_mapper->setMapping( action, domain );
         }
+    };
+    add_domains( pinned_domains );
+    add_domains( recent_domains );
+}
+
+void MainWindow::FillAliasComboBox( QComboBox *combo_box, QString const & prefix ) const
+{
+    // the index answers in microseconds, only what fits in the list is ever formatted
+    QMap<QString, Alias> const & aliases = store.Aliases();
+    combo_box->clear();
+    for( auto const & name: store.SearchAliases( prefix, s_max_alias_choices ) ){
+        combo_box->addItem( name + tr( " | %1" ).arg( aliases[name].AddressText() ), name );
     }
-    QObject::connect( signal_mapper, SIGNAL( mapped(QString)), this, SLOT(OnActionMapped(QString)) );
+}
+
+void MainWindow::NoteRecentDomain( QString const & domain_name )
+{
+    if( pinned_domains.contains( domain_name ) ) return;
+    recent_domains.removeAll( domain_name );
+    recent_domains.prepend( domain_name );
+    while( recent_domains.size() > s_max_recent_domains ) recent_domains.removeLast();
+
+    QSettings{}.setValue( "recent_domains", recent_domains );
+    RebuildPointMenu();
+}
+
+void MainWindow::OnStatisticsTriggered()
+{
+    statistics_dialog dialog{ *sync_coalescer, *config_writer, this };
+    dialog.exec();
+}
+
+void MainWindow::OnBrowseDomainsTriggered()
+{
+    domain_browser_dialog browser{ store.DomainOwners(), store.RuleHosts(), pinned_domains, this };
+    if( browser.exec() != QDialog::Accepted ) return;
+
+    QString const domain_name = browser.SelectedDomain();
+    switch( browser.SelectedRequest() ){
+    case domain_browser_dialog::Request::Point:
+        OnActionMapped( domain_name );
+        return;
+    case domain_browser_dialog::Request::Pin:
+        if( pinned_domains.contains( domain_name ) ) return;
+        pinned_domains.append( domain_name );
+        recent_domains.removeAll( domain_name );
+        break;
+    case domain_browser_dialog::Request::Unpin:
+        if( pinned_domains.removeAll( domain_name ) == 0 ) return;
+        break;
+    }
+    QSettings settings {};
+    settings.setValue( "pinned_domains", pinned_domains );
+    settings.setValue( "recent_domains", recent_domains );
+    RebuildPointMenu();
 }
 
 void MainWindow::OnActionMapped( QString const & name )
@@ -449,40 +598,30 @@ void MainWindow::OnActionMapped( QString const & name )
     layout->addWidget( new QLabel( "Point"));
     layout->addWidget( domain_line_edit, 0, 0 );
 
-    QStringList list {};
-    for( auto & key: aliases.keys() ){
-        list << key + tr( "( %1 )" ).arg( aliases.value( key ).Address() );
-    }
-    if( list.isEmpty() ){
+    if( store.Aliases().isEmpty() ){
         QMessageBox::information( this, s_title, "No aliases found, try adding at least one." );
         return;
     }
 
-    int index = 0;
+    QLineEdit *alias_search_line_edit = new QLineEdit();
+    alias_search_line_edit->setPlaceholderText( "Search by name, IP or domain" );
     QComboBox *alias_combo_box = new QComboBox();
-    QObject::connect( alias_combo_box,
-                      static_cast<void( QComboBox::* )( int )>( &QComboBox::currentIndexChanged ),
-                      [&]( int new_index ) mutable -> void
-    {
-        index = new_index;
+    FillAliasComboBox( alias_combo_box, QString{} );
+    QObject::connect( alias_search_line_edit, &QLineEdit::textChanged, [this, alias_combo_box]( QString const & text ){
+        FillAliasComboBox( alias_combo_box, text.trimmed() );
     });
-    alias_combo_box->addItems( list );
     layout->addWidget( new QLabel( "towards available aliases" ), 1, 0 );
-    layout->addWidget( alias_combo_box, 2,0 );
+    layout->addWidget( alias_search_line_edit, 2, 0 );
+    layout->addWidget( alias_combo_box, 3, 0 );
 
     QPushButton *ok_button = new QPushButton( "Point" );
     QObject::connect( ok_button, &QPushButton::clicked, [&]() mutable {
-        for( auto & key: aliases.keys() ){
-            Alias &alias = aliases[key];
-            auto &domain_names = alias.GetDomainNames();
-            auto iter = domain_names.find( name );
-            if( iter != domain_names.end() ){
-                alias.RemoveDomainName( name );
-            }
+        if( !store.PointDomainTo( name, alias_combo_box->currentData().toString() ) ){
+            SHOW_CMESSAGE( "Select an alias for the domain name to point to" );
+            return;
         }
-        Alias &insert_alias = aliases[ aliases.keys()[index] ];
-        insert_alias.InsertDomainName( name );
-        QString const message = name + " now pointing to " + alias_combo_box->itemText( index );
+        NoteRecentDomain( name );
+        QString const message = name + " now pointing to " + alias_combo_box->currentText();
         QMessageBox::information( this, s_title, message );
 
         SyncConfigFile();
@@ -490,10 +629,126 @@ void MainWindow::OnActionMapped( QString const & name )
 
         point_dialog->accept();
     });
-    layout->addWidget( ok_button, 3, 0 );
+    layout->addWidget( ok_button, 4, 0 );
     point_dialog->setLayout( layout );
     point_dialog->setMaximumSize( QSize( 300, 300 ));
     point_dialog->exec();
 }
 
+void MainWindow::RebuildProfilesMenu()
+{
+    for( QAction *action: profiles_menu->actions() ){
+        profiles_menu->removeAction( action );
+        if( action->parent() == profiles_menu ) action->deleteLater();
+    }
+    profiles_menu->addAction( save_profile_action );
+    QStringList const names = store.ProfileNames();
+    if( !names.isEmpty() ) profiles_menu->addSeparator();
+    for( auto const & name: names ){
+        QAction *action = new QAction( name, profiles_menu );
+        action->setData( name );
+        action->setCheckable( true );
+        action->setChecked( name == store.ActiveProfile() );
+        profiles_menu->addAction( action );
+    }
+}
+
+void MainWindow::OnSaveProfileTriggered()
+{
+    bool accepted = false;
+    QString const name = QInputDialog::getText( this, s_title, "Profile name", QLineEdit::Normal,
+                                                store.ActiveProfile(), &accepted ).trimmed();
+    if( !accepted ) return;
+    if( name.isEmpty() ){
+        SHOW_CMESSAGE( "The profile name cannot be left empty" );
+        return;
+    }
+    store.SaveProfile( name );
+    SyncConfigFile();
+    // the writer renders the profile's hosts image along with config.json
+    CompactConfigFile();
+}
+
+void MainWindow::OnProfileTriggered( QAction *action )
+{
+    QString const name = action->data().toString();
+    if( name.isEmpty() || !store.SwitchToProfile( name ) ) return;
+
+    // the hosts file is swapped for the profile's pre-rendered image, no need to wait
+    SyncConfigFile();
+    SyncConfigWithHostsFile();
+    sync_coalescer->FlushNow();
+    tray_icon->showMessage( s_title, "Switched to the " + name + " profile" );
+}
+
+void MainWindow::OnImportBlocklistsTriggered()
+{
+    QStringList const filenames = QFileDialog::getOpenFileNames( this, "Import blocklists" );
+    if( filenames.isEmpty() ) return;
+
+    // lists run to millions of lines; nothing may change the store until they are merged
+    SetStoreActionsEnabled( false );
+    statusBar()->showMessage( tr( "Importing %1 blocklists..." ).arg( filenames.size() ) );
+    AliasSnapshotPtr const snapshot = store.Publish();
+    blocklist_loader->setFuture( QtConcurrent::run( [filenames, snapshot]{
+        ImportedLists imported{ std::make_shared<BlocklistImporter>(), QStringList{}, 0, snapshot->version };
+        for( auto const & filename: filenames ){
+            BlocklistImporter::SourceStats const stats = imported.importer->AddFile( filename );
+            QString const name = QFileInfo( filename ).fileName();
+            if( !stats.readable ){
+                imported.report.append( name + ": unable to open" );
+                continue;
+            }
+            imported.report.append( tr( "%1: %2 unique, %3 duplicates, %4 conflicting" ).arg( name )
+                                    .arg( stats.unique ).arg( stats.duplicates ).arg( stats.conflicts ) );
+        }
+        imported.already_owned = imported.importer->DropOwned( *snapshot );
+        return imported;
+    }));
+}
+
+void MainWindow::OnBlocklistsImported()
+{
+    ImportedLists imported = blocklist_loader->result();
+    statusBar()->clearMessage();
+    SetStoreActionsEnabled( true );
+    // the hosts file watcher may still have moved domains while the lists were read
+    AliasSnapshotPtr const snapshot = store.Publish();
+    if( snapshot->version != imported.version ) imported.already_owned += imported.importer->DropOwned( *snapshot );
+
+    int const changed = store.MergeHostsEntries( imported.importer->Mapping(), HostsMapping{} );
+    if( changed != 0 ){
+        SyncConfigFile();
+        SyncConfigWithHostsFile();
+    }
+    if( imported.already_owned != 0 ){
+        imported.report.append( tr( "%1 domains already in the configuration were left where they point" )
+                                .arg( imported.already_owned ) );
+    }
+    imported.report.append( tr( "%1 domains added" ).arg( changed ) );
+    QMessageBox::information( this, s_title, imported.report.join( '\n' ) );
+}
+
+void MainWindow::OnDnsResponderToggled( bool enabled )
+{
+    QSettings settings {};
+    settings.setValue( "dns/enabled", enabled );
+    if( !enabled ){
+        dns_responder->Stop();
+        return;
+    }
+    quint16 const port = static_cast<quint16>( settings.value( "dns/port", DnsResponder::s_default_port ).toUInt() );
+    QString const upstream = settings.value( "dns/upstream" ).toString();
+    dns_table.Sync( store.Snapshot() );
+    QString error {};
+    if( !dns_responder->Start( port, upstream, error ) ){
+        SHOW_CMESSAGE( tr( "The DNS responder could not listen on 127.0.0.1:%1: %2" ).arg( port ).arg( error ) );
+        settings.setValue( "dns/enabled", false );
+        QSignalBlocker const blocker{ dns_action };
+        dns_action->setChecked( false );
+        return;
+    }
+    tray_icon->showMessage( s_title, tr( "Answering DNS queries on 127.0.0.1:%1" ).arg( dns_responder->Port() ) );
+}
+
 #undef SHOW_CMESSAGE
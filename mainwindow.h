@@ -2,14 +2,24 @@
 #define MAINWINDOW_H
 
 #include <QAction>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QMainWindow>
 #include <QMap>
 #include <QMenu>
 #include <QSystemTrayIcon>
-#include <set>
 #include <QList>
+#include <memory>
 
 #include "alias.hpp"
+#include "alias_store.hpp"
+#include "blocklist_importer.hpp"
+#include "config_journal.hpp"
+#include "config_writer.hpp"
+#include "dns_responder.hpp"
+#include "dns_table.hpp"
+#include "hosts_watcher.hpp"
+#include "write_coalescer.hpp"
 
 namespace Ui {
 class MainWindow;
@@ -19,6 +29,8 @@ class MainWindow;
 
 #define SHOW_CMESSAGE(msg) (QMessageBox::critical(this,s_title, msg))
 
+class QComboBox;
+class QProgressBar;
 class QSignalMapper;
 
 class MainWindow : public QMainWindow
@@ -28,6 +40,8 @@ class MainWindow : public QMainWindow
 public:
     static QString s_title;
     static QString s_config_filename;
+    static int const s_max_recent_domains;
+    static int const s_max_alias_choices;
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
@@ -37,34 +51,105 @@ private slots: // callbacks
     void OnTrayIconActivated( QSystemTrayIcon::ActivationReason );
     void OnActionMapped( QString const & action_name );
     void OnAddAliasTriggered();
+    void OnBrowseDomainsTriggered();
+    void OnStatisticsTriggered();
     void OnConfigureActionTriggered();
+    void OnWriteFailed( quint64 job_id, QString const & error );
+    void OnAboutToQuit();
+    void OnSyncFlush( int targets );
+    void OnWriteFinished( quint64 job_id );
+    void OnHostsEntriesChanged( HostsMapping const & added, HostsMapping const & removed );
+    void OnConfigFileChanged();
+    void OnSaveProfileTriggered();
+    void OnProfileTriggered( QAction *action );
+    void OnImportBlocklistsTriggered();
+    void OnDnsResponderToggled( bool enabled );
+    void OnConfigLoaded();
+    void OnConfigReloaded();
+    void OnBlocklistsImported();
 
 protected:
     // needed to be overriden to prevent the default behavior of closing a window
     void closeEvent( QCloseEvent *event ) override;
 private:
+    // what the loader thread hands back; the store is built off the GUI thread and moved in whole
+    struct LoadedConfig {
+        std::shared_ptr<AliasStore> store;
+        QString                     error;
+        QStringList                 warnings;
+    };
+    // what the import thread hands back: the lists merged, less what the config already owned
+    // as of `version`
+    struct ImportedLists {
+        std::shared_ptr<BlocklistImporter> importer;
+        QStringList                        report;
+        qint64                             already_owned;
+        quint64                            version;
+    };
+
     void CreateMenus();
     void CreateSystemTrayIcon();
+    // walks a first run through creating config.json, then loads it on a worker thread while
+    // the window and tray are already up. OnConfigLoaded takes over from there
     void ReadConfigFile();
+    // everything that reads or changes the store waits for the config to be loaded
+    void SetStoreActionsEnabled( bool enabled );
+    // asks for an address for every alias config.json gave one that can't be used;
+    // one left as is stays out of the hosts file
+    void FixUnusableAddresses();
     void MapAliasesToActionSignals();
-    bool ReadHostsFile(QString const & host_filename, OUT_PARAM QMap<QString, list_str_pair> & );
-    void WriteHostFileToConfigFile(QString const & config_path, QString const & hosts_file_path,
-                                    QMap<QString, list_str_pair> const & );
+    void RebuildPointMenu();
+    void NoteRecentDomain( QString const & domain_name );
+    void RebuildProfilesMenu();
+    // the first s_max_alias_choices aliases matching `prefix`, the combo box keeps the name as data
+    void FillAliasComboBox( QComboBox *combo_box, QString const & prefix ) const;
+    // both only mark the files dirty, bursts are written once by the writer thread
     void SyncConfigWithHostsFile();
+    // appends the store's changes to the journal, config.json is only rewritten once
+    // the journal has outgrown ConfigJournal::s_compact_threshold
     void SyncConfigFile();
+    void CompactConfigFile();
+    // the responder answers from the table, so it has to hear about every change right away
+    void SyncDnsTable();
+    // the watcher stays suspended from the first queued write until the last one is done
+    void EndWrite( quint64 job_id );
+    ConfigState CurrentState() const;
 private:
     Ui::MainWindow  *ui;
     QMenu           *point_menu;
+    QMenu           *profiles_menu;
+    QAction         *save_profile_action;
     QAction         *configure_action;
     QAction         *add_alias_action;
     QAction         *exit_action;
+    QAction         *browse_domains_action;
+    QAction         *statistics_action;
+    QAction         *import_action;
+    QAction         *dns_action;
     QMenu           *tray_icon_menu;
     QSystemTrayIcon *tray_icon;
     QSignalMapper   *signal_mapper;
+    ConfigWriter    *config_writer;
+    WriteCoalescer  *sync_coalescer;
+    HostsFileWatcher *file_watcher;
+    quint64          last_write_job;
+    bool             write_in_flight;
+    ConfigJournal    journal;
+    DnsTable         dns_table;
+    DnsResponder     *dns_responder;
+    QFutureWatcher<LoadedConfig> *config_loader;
+    QFutureWatcher<ImportedLists> *blocklist_loader;
+    // reloads config.json after another program changed it
+    QFutureWatcher<LoadedConfig> *config_reloader;
+    QProgressBar     *load_progress;
+    // the store's version when the reload started, a newer one means it changed meanwhile
+    quint64          reload_version;
+    // config.json changed again while it was being reloaded
+    bool             reload_again;
 
-    QString               hosts_file_path;
-    QMap<QString, Alias>  aliases;
-    std::set<QString>     domain_names;
+    AliasStore            store;
+    QStringList           recent_domains;
+    QStringList           pinned_domains;
 };
 #undef OUT_PARAM
 
@@ -0,0 +1,220 @@
+#include "profile_cache.hpp"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#if defined( Q_OS_WIN )
+#include <windows.h>
+#elif defined( Q_OS_UNIX )
+#include <cstdio>
+#include <cerrno>
+#endif
+
+namespace {
+    quint64 Mix( quint64 hash, char const * data, int length )
+    {
+        for( int i = 0; i != length; ++i ) hash = ( hash ^ static_cast<uchar>( data[i] ) ) * 1099511628211ULL;
+        return hash;
+    }
+
+    quint64 Mix( quint64 hash, QByteArray const & bytes )
+    {
+        // the length keeps "ab" + "c" apart from "a" + "bc"
+        int const length = bytes.size();
+        hash = Mix( hash, reinterpret_cast<char const *>( &length ), sizeof( length ) );
+        return Mix( hash, bytes.constData(), bytes.size() );
+    }
+
+    QString ProfileDirectory( QString const & config_path )
+    {
+        return config_path + ".profiles";
+    }
+
+    // the image is copied through this much at a time, whatever its size
+    qint64 const s_copy_chunk = 1 << 20;
+
+    bool StartsWith( QString const & path, QByteArray const & line )
+    {
+        QFile file{ path };
+        if( !file.open( QIODevice::ReadOnly ) ) return false;
+        return file.readLine( line.size() + 1 ) == line;
+    }
+
+    // a copy, never a link: the hosts file must not share a file( nor its owner, mode or
+    // security label ) with the cache. QSaveFile syncs it before renaming it into place,
+    // so a staged copy is whole by the time anything renames it further
+    bool CopyImage( QString const & image_path, QString const & copy_path, QString const & target_path, QString & error )
+    {
+        QFile image{ image_path };
+        QSaveFile copy{ copy_path };
+        if( !image.open( QIODevice::ReadOnly ) || !copy.open( QIODevice::WriteOnly ) ){
+            error = image.isOpen() ? copy.errorString() : image.errorString();
+            return false;
+        }
+        QByteArray chunk {};
+        while( !( chunk = image.read( s_copy_chunk ) ).isEmpty() ){
+            if( copy.write( chunk ) != chunk.size() ){
+                error = copy.errorString();
+                copy.cancelWriting();
+                return false;
+            }
+        }
+        if( image.error() != QFileDevice::NoError ){
+            error = image.errorString();
+            copy.cancelWriting();
+            return false;
+        }
+        if( !copy.commit() ){
+            error = copy.errorString();
+            return false;
+        }
+        // the rename hands the copy's mode to the hosts file, give it the one it has now
+        if( QFile::exists( target_path ) ) QFile::setPermissions( copy_path, QFile::permissions( target_path ) );
+        return true;
+    }
+
+    // QFile::rename won't replace an existing file, this does in one step
+    bool ReplaceFile( QString const & from, QString const & to, QString & error )
+    {
+#if defined( Q_OS_WIN )
+        QString const native_from = QDir::toNativeSeparators( from );
+        QString const native_to = QDir::toNativeSeparators( to );
+        if( MoveFileExW( reinterpret_cast<LPCWSTR>( native_from.utf16() ), reinterpret_cast<LPCWSTR>( native_to.utf16() ),
+                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != 0 ) return true;
+        error = qt_error_string( static_cast<int>( GetLastError() ) );
+        return false;
+#elif defined( Q_OS_UNIX )
+        if( std::rename( QFile::encodeName( from ).constData(), QFile::encodeName( to ).constData() ) == 0 ) return true;
+        error = qt_error_string( errno );
+        return false;
+#else
+        QFile::remove( to );
+        if( QFile::rename( from, to ) ) return true;
+        error = "Unable to rename " + from + " to " + to;
+        return false;
+#endif
+    }
+
+    QString StagedPrefix( QString const & target_path )
+    {
+        return "." + QFileInfo( target_path ).fileName() + ".profile-";
+    }
+}
+
+QString ProfileCache::ImagePath( QString const & config_path, QString const & profile_name )
+{
+    // hex keeps any profile name a valid, collision free file name
+    return ProfileDirectory( config_path ) + "/" + QString::fromLatin1( profile_name.toUtf8().toHex() ) + ".hosts";
+}
+
+QString ProfileCache::StagedPath( QString const & target_path, QString const & profile_name )
+{
+    // same directory as the target, so the rename never crosses a filesystem
+    return QFileInfo( target_path ).absolutePath() + "/" + StagedPrefix( target_path ) +
+           QString::fromLatin1( profile_name.toUtf8().toHex() );
+}
+
+quint64 ProfileCache::Fingerprint( Profile const & profile )
+{
+    DomainPool &pool = DomainPool::Global();
+    quint64 hash = 14695981039346656037ULL;
+    for( auto const & alias: profile.aliases ){
+        hash = Mix( hash, alias.Name().toUtf8() );
+        quint64 const address[2] = { alias.Address().High(), alias.Address().Low() };
+        hash = Mix( hash, reinterpret_cast<char const *>( address ), sizeof( address ) );
+        if( !alias.HasAddress() ) hash = Mix( hash, alias.UnparsedAddress().toUtf8() );
+        for( DomainId const id: alias.GetDomainNames() ) hash = Mix( hash, pool.Utf8( id ) );
+        for( auto const & pattern: alias.Wildcards() ){
+            hash = Mix( hash, pattern.toUtf8() );
+            for( DomainId const id: profile.wildcard_hosts.value( pattern ) ) hash = Mix( hash, pool.Utf8( id ) );
+        }
+    }
+    return hash;
+}
+
+QByteArray ProfileCache::FirstLine( QString const & profile_name, quint64 fingerprint )
+{
+    return "# Profile: " + profile_name.toUtf8() + " " + QByteArray::number( fingerprint, 16 ) + "\n";
+}
+
+bool ProfileCache::IsCurrent( QString const & config_path, QString const & profile_name, Profile const & profile )
+{
+    return StartsWith( ImagePath( config_path, profile_name ), FirstLine( profile_name, profile.fingerprint ) );
+}
+
+bool ProfileCache::Refresh( ConfigState const & state, QString & error )
+{
+    QDir directory{ ProfileDirectory( state.config_path ) };
+    if( state.profiles.isEmpty() && !directory.exists() ) return Stage( state, error );
+    if( !directory.exists() && !directory.mkpath( "." ) ){
+        error = "Unable to create " + directory.path();
+        return false;
+    }
+
+    QStringList images {};
+    for( auto iter = state.profiles.cbegin(); iter != state.profiles.cend(); ++iter ){
+        QString const path = ImagePath( state.config_path, iter.key() );
+        images << QFileInfo( path ).fileName();
+        if( IsCurrent( state.config_path, iter.key(), iter.value() ) ) continue;
+
+        ConfigState const profile_state{ state.config_path, state.hosts_file_path, iter->aliases,
+                                         iter->wildcard_hosts, {}, {}, 0, {} };
+        // QSaveFile syncs the image to disk before renaming it into place, so a copy
+        // taken of it later never reads data that isn't there yet
+        QSaveFile image{ path };
+        if( !image.open( QIODevice::WriteOnly ) ){
+            error = image.errorString();
+            return false;
+        }
+        image.write( FirstLine( iter.key(), iter->fingerprint ) );
+        // the image sits unused until a switch, a "Last sync" line would be stale by then
+        QByteArray const stamp = "# Profile " + iter.key().toUtf8() + " rendered " +
+                                 QDateTime::currentDateTime().toString().toUtf8() + "\n\n";
+        // part by part, the blocks are the writer's cached ones and are never joined
+        for( auto const & part: ConfigWriter::RenderHostsFileParts( profile_state, stamp ) ) image.write( part );
+        if( !image.commit() ){
+            error = image.errorString();
+            return false;
+        }
+    }
+    for( auto const & name: directory.entryList( { "*.hosts" }, QDir::Files ) ){
+        if( !images.contains( name ) ) directory.remove( name );
+    }
+    return Stage( state, error );
+}
+
+bool ProfileCache::Stage( ConfigState const & state, QString & error )
+{
+    QStringList targets{ state.hosts_file_path };
+    targets << state.hosts_file_targets;
+    for( auto const & target: targets ){
+        QStringList staged {};
+        for( auto iter = state.profiles.cbegin(); iter != state.profiles.cend(); ++iter ){
+            QString const path = StagedPath( target, iter.key() );
+            staged << QFileInfo( path ).fileName();
+            if( StartsWith( path, FirstLine( iter.key(), iter->fingerprint ) ) ) continue;
+            if( !IsCurrent( state.config_path, iter.key(), iter.value() ) ) continue;
+            if( !CopyImage( ImagePath( state.config_path, iter.key() ), path, target, error ) ){
+                error = path + ": " + error;
+                return false;
+            }
+        }
+        QDir const directory = QFileInfo( target ).absoluteDir();
+        for( auto const & name: directory.entryList( { StagedPrefix( target ) + "*" }, QDir::Files | QDir::Hidden ) ){
+            if( !staged.contains( name ) ) QFile::remove( directory.filePath( name ) );
+        }
+    }
+    return true;
+}
+
+bool ProfileCache::Swap( QString const & config_path, QString const & profile_name, Profile const & profile,
+                         QString const & target_path, QString & error )
+{
+    QString const staged = StagedPath( target_path, profile_name );
+    if( !StartsWith( staged, FirstLine( profile_name, profile.fingerprint ) ) &&
+        !CopyImage( ImagePath( config_path, profile_name ), staged, target_path, error ) ) return false;
+    return ReplaceFile( staged, target_path, error );
+}
@@ -0,0 +1,35 @@
+#ifndef PROFILE_CACHE_HPP
+#define PROFILE_CACHE_HPP
+
+#include <QString>
+#include "config_writer.hpp"
+
+// Pre-rendered hosts file images of the profiles, kept in "<config>.profiles/". Every
+// image starts with a "# Profile: <name> <fingerprint>" line, so a stale one is found
+// by reading a single line. Each image is also staged ahead of time as a hidden copy
+// next to every hosts file it can replace, on the same filesystem, so switching the
+// file to a profile is a single rename whatever the size of the image.
+class ProfileCache
+{
+public:
+    static QString ImagePath( QString const & config_path, QString const & profile_name );
+    // ".<hosts file name>.profile-<hex name>", in the directory of `target_path`
+    static QString StagedPath( QString const & target_path, QString const & profile_name );
+    static quint64 Fingerprint( Profile const & profile );
+
+    // renders every missing or stale image, stages them and removes those of deleted profiles
+    static bool Refresh( ConfigState const & state, QString & error );
+    // copies every missing or stale image next to the hosts file and each of hosts_file_targets
+    static bool Stage( ConfigState const & state, QString & error );
+    static bool IsCurrent( QString const & config_path, QString const & profile_name, Profile const & profile );
+    // renames the staged copy over `target_path`, readers see either the old or the new file.
+    // A copy that isn't staged yet is staged first, which costs a copy of the image; the
+    // one consumed by the rename is staged again by the next Stage()
+    static bool Swap( QString const & config_path, QString const & profile_name, Profile const & profile,
+                      QString const & target_path, QString & error );
+
+private:
+    static QByteArray FirstLine( QString const & profile_name, quint64 fingerprint );
+};
+
+#endif // PROFILE_CACHE_HPP
@@ -0,0 +1,77 @@
+#include "search_index.hpp"
+#include <algorithm>
+#include <iterator>
+
+// below this the small run is cheap to sort and to walk, folding it in isn't worth it
+std::size_t const SearchIndex::s_min_merge = 1024;
+
+SearchIndex::SearchIndex(): bytes{}, sorted{}, recent{}, recent_sorted{ true }
+{
+}
+
+void SearchIndex::Add( QString const & key, quint32 id )
+{
+    QByteArray const utf8 = key.toUtf8();
+    Add( utf8.constData(), utf8.size(), id );
+}
+
+void SearchIndex::Add( char const * utf8, int length, quint32 id )
+{
+    quint32 const offset = static_cast<quint32>( bytes.size() );
+    // only ASCII is folded here; QString::toLower on the query does the rest, and the names
+    // this indexes are ASCII( or punycode ) in practice
+    for( int i = 0; i != length; ++i ){
+        char const c = utf8[i];
+        bytes.push_back( c >= 'A' && c <= 'Z' ? static_cast<char>( c + ( 'a' - 'A' ) ) : c );
+    }
+    recent.push_back( Entry{ offset, static_cast<quint32>( length ), id } );
+    recent_sorted = false;
+}
+
+void SearchIndex::Clear()
+{
+    bytes.clear();
+    sorted.clear();
+    recent.clear();
+    recent_sorted = true;
+}
+
+int SearchIndex::Size() const
+{
+    return static_cast<int>( sorted.size() + recent.size() );
+}
+
+bool SearchIndex::Less( Entry const & lhs, Entry const & rhs ) const
+{
+    int const common = static_cast<int>( qMin( lhs.length, rhs.length ) );
+    int const order = std::memcmp( bytes.data() + lhs.offset, bytes.data() + rhs.offset, common );
+    return order != 0 ? order < 0 : lhs.length < rhs.length;
+}
+
+std::size_t SearchIndex::LowerBound( std::vector<Entry> const & run, QByteArray const & prefix ) const
+{
+    auto const iter = std::lower_bound( run.cbegin(), run.cend(), prefix,
+                                        [this]( Entry const & entry, QByteArray const & key ){
+        int const common = static_cast<int>( qMin<quint32>( entry.length, key.size() ) );
+        int const order = std::memcmp( bytes.data() + entry.offset, key.constData(), common );
+        return order != 0 ? order < 0 : entry.length < static_cast<quint32>( key.size() );
+    });
+    return static_cast<std::size_t>( iter - run.cbegin() );
+}
+
+void SearchIndex::Normalize()
+{
+    if( recent_sorted ) return;
+    auto const less = [this]( Entry const & lhs, Entry const & rhs ){ return Less( lhs, rhs ); };
+    std::sort( recent.begin(), recent.end(), less );
+    recent_sorted = true;
+    // a fraction of the big run, so each entry is moved O(1) times on average over all merges
+    if( recent.size() < qMax( s_min_merge, sorted.size() / 8 ) ) return;
+
+    std::vector<Entry> merged {};
+    merged.reserve( sorted.size() + recent.size() );
+    std::merge( sorted.cbegin(), sorted.cend(), recent.cbegin(), recent.cend(),
+                std::back_inserter( merged ), less );
+    sorted.swap( merged );
+    recent.clear();
+}
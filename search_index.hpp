@@ -0,0 +1,74 @@
+#ifndef SEARCH_INDEX_HPP
+#define SEARCH_INDEX_HPP
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+#include <cstring>
+#include <vector>
+
+// Case insensitive prefix lookup over keys that only ever get added( alias names, addresses,
+// domain names ), each tagged with the caller's id. Keys live lowercased in one arena and
+// are referred to from two sorted runs: the big one and a small one that takes the adds.
+// The small run is sorted on the next lookup and folded into the big one once it has grown
+// past a fraction of it, so adding is O(1) and a lookup is two binary searches plus the
+// matches it returns.
+class SearchIndex
+{
+public:
+    SearchIndex();
+
+    void Add( QString const & key, quint32 id );
+    void Add( char const * utf8, int length, quint32 id );
+    void Clear();
+    int  Size() const;
+
+    // calls visit( id ) for every key starting with `prefix`, in key order, until it returns
+    // false. An empty prefix visits everything
+    template<typename Visitor>
+    void Find( QString const & prefix, Visitor && visit );
+private:
+    struct Entry {
+        quint32 offset;
+        quint32 length;
+        quint32 id;
+    };
+
+    void  Normalize();
+    bool  Less( Entry const & lhs, Entry const & rhs ) const;
+    // first entry of `run` not ordered before `prefix`
+    std::size_t LowerBound( std::vector<Entry> const & run, QByteArray const & prefix ) const;
+    bool  HasPrefix( Entry const & entry, QByteArray const & prefix ) const;
+
+    static std::size_t const s_min_merge;
+
+    std::vector<char>  bytes;
+    std::vector<Entry> sorted;
+    std::vector<Entry> recent;
+    bool               recent_sorted;
+};
+
+inline bool SearchIndex::HasPrefix( Entry const & entry, QByteArray const & prefix ) const
+{
+    return entry.length >= static_cast<quint32>( prefix.size() ) &&
+            std::memcmp( bytes.data() + entry.offset, prefix.constData(), prefix.size() ) == 0;
+}
+
+template<typename Visitor>
+void SearchIndex::Find( QString const & prefix, Visitor && visit )
+{
+    Normalize();
+    QByteArray const key = prefix.toLower().toUtf8();
+    // both runs are walked side by side so the matches come out in key order
+    std::size_t s = LowerBound( sorted, key ), r = LowerBound( recent, key );
+    for( ;; ){
+        bool const in_sorted = s < sorted.size() && HasPrefix( sorted[s], key );
+        bool const in_recent = r < recent.size() && HasPrefix( recent[r], key );
+        if( !in_sorted && !in_recent ) return;
+        bool const take_recent = in_recent && ( !in_sorted || Less( recent[r], sorted[s] ) );
+        Entry const & entry = take_recent ? recent[r++] : sorted[s++];
+        if( !visit( entry.id ) ) return;
+    }
+}
+
+#endif // SEARCH_INDEX_HPP
@@ -0,0 +1,160 @@
+#include "statistics.hpp"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QTextStream>
+
+std::atomic<bool> Statistics::s_enabled{ true };
+
+Statistics::Statistics()
+{
+    Reset();
+}
+
+Statistics & Statistics::Global()
+{
+    static Statistics statistics {};
+    return statistics;
+}
+
+void Statistics::SetEnabled( bool enabled ) { s_enabled.store( enabled, std::memory_order_relaxed ); }
+
+QString Statistics::PhaseName( Phase phase )
+{
+    switch( phase ){
+    case ConfigLoad:  return "config_load";
+    case JsonParse:   return "json_parse";
+    case HostsParse:  return "hosts_parse";
+    case HostsRender: return "hosts_render";
+    case FileWrite:   return "file_write";
+    case MenuBuild:   return "menu_build";
+    case DnsQuery:    return "dns_query";
+    case Startup:     return "startup";
+    default:          return "unknown";
+    }
+}
+
+void Statistics::RecordLatency( Phase phase, qint64 nanoseconds )
+{
+    if( !IsEnabled() ) return;
+    PhaseCounters &counters = phases[phase];
+    quint64 const ns = nanoseconds < 0 ? 0 : static_cast<quint64>( nanoseconds );
+    counters.count.fetch_add( 1, std::memory_order_relaxed );
+    counters.total_ns.fetch_add( ns, std::memory_order_relaxed );
+
+    quint64 max = counters.max_ns.load( std::memory_order_relaxed );
+    while( ns > max && !counters.max_ns.compare_exchange_weak( max, ns, std::memory_order_relaxed ) ){}
+
+    int bucket = 0;
+    for( quint64 us = ns / 1000; us != 0 && bucket + 1 < s_bucket_count; us >>= 1 ) ++bucket;
+    counters.buckets[bucket].fetch_add( 1, std::memory_order_relaxed );
+}
+
+void Statistics::AddBytesRead( Phase phase, qint64 bytes )
+{
+    if( IsEnabled() && bytes > 0 ) phases[phase].bytes_read.fetch_add( bytes, std::memory_order_relaxed );
+}
+
+void Statistics::AddBytesWritten( Phase phase, qint64 bytes )
+{
+    if( IsEnabled() && bytes > 0 ) phases[phase].bytes_written.fetch_add( bytes, std::memory_order_relaxed );
+}
+
+void Statistics::AddEntries( Phase phase, qint64 entries )
+{
+    if( IsEnabled() && entries > 0 ) phases[phase].entries.fetch_add( entries, std::memory_order_relaxed );
+}
+
+void Statistics::Reset()
+{
+    for( auto & counters: phases ){
+        counters.count.store( 0 );
+        counters.total_ns.store( 0 );
+        counters.max_ns.store( 0 );
+        counters.bytes_read.store( 0 );
+        counters.bytes_written.store( 0 );
+        counters.entries.store( 0 );
+        for( auto & bucket: counters.buckets ) bucket.store( 0 );
+    }
+}
+
+quint64 Statistics::Quantile( PhaseCounters const & counters, double q )
+{
+    quint64 const count = counters.count.load( std::memory_order_relaxed );
+    if( count == 0 ) return 0;
+    quint64 const rank = static_cast<quint64>( q * ( count - 1 ) ) + 1;
+    quint64 seen = 0;
+    for( int i = 0; i != s_bucket_count; ++i ){
+        seen += counters.buckets[i].load( std::memory_order_relaxed );
+        if( seen >= rank ) return quint64{ 1 } << i;
+    }
+    return quint64{ 1 } << ( s_bucket_count - 1 );
+}
+
+QJsonObject Statistics::ToJson() const
+{
+    using Pair = QPair<QString, QJsonValue>;
+    QJsonObject json_phases {};
+    for( int phase = 0; phase != PhaseCount; ++phase ){
+        PhaseCounters const &counters = phases[phase];
+        QJsonArray histogram {};
+        for( auto const & bucket: counters.buckets ){
+            histogram.append( static_cast<double>( bucket.load( std::memory_order_relaxed ) ) );
+        }
+        quint64 const count = counters.count.load( std::memory_order_relaxed );
+        double const total_ms = counters.total_ns.load( std::memory_order_relaxed ) / 1e6;
+        json_phases.insert( PhaseName( static_cast<Phase>( phase ) ), QJsonObject( {
+            Pair( "count", static_cast<double>( count ) ),
+            Pair( "total_ms", total_ms ),
+            Pair( "mean_ms", count ? total_ms / count : 0.0 ),
+            Pair( "max_ms", counters.max_ns.load( std::memory_order_relaxed ) / 1e6 ),
+            Pair( "p50_us_upper", static_cast<double>( Quantile( counters, 0.5 ) ) ),
+            Pair( "p99_us_upper", static_cast<double>( Quantile( counters, 0.99 ) ) ),
+            Pair( "bytes_read", static_cast<double>( counters.bytes_read.load( std::memory_order_relaxed ) ) ),
+            Pair( "bytes_written", static_cast<double>( counters.bytes_written.load( std::memory_order_relaxed ) ) ),
+            Pair( "entries", static_cast<double>( counters.entries.load( std::memory_order_relaxed ) ) ),
+            Pair( "histogram_log2_us", histogram )
+        }));
+    }
+    return QJsonObject( { Pair( "enabled", IsEnabled() ), Pair( "phases", json_phases ) } );
+}
+
+QString Statistics::ToText() const
+{
+    QString text {};
+    QTextStream stream{ &text };
+    stream << ( IsEnabled() ? "" : "(instrumentation is disabled)\n" );
+    for( int phase = 0; phase != PhaseCount; ++phase ){
+        PhaseCounters const &counters = phases[phase];
+        quint64 const count = counters.count.load( std::memory_order_relaxed );
+        double const total_ms = counters.total_ns.load( std::memory_order_relaxed ) / 1e6;
+        stream << PhaseName( static_cast<Phase>( phase ) ) << "\n"
+               << "    runs: " << count
+               << ", mean: " << ( count ? total_ms / count : 0.0 ) << " ms"
+               << ", max: " << counters.max_ns.load( std::memory_order_relaxed ) / 1e6 << " ms"
+               << ", p50 < " << Quantile( counters, 0.5 ) << " us"
+               << ", p99 < " << Quantile( counters, 0.99 ) << " us\n"
+               << "    read: " << counters.bytes_read.load( std::memory_order_relaxed ) << " B"
+               << ", written: " << counters.bytes_written.load( std::memory_order_relaxed ) << " B"
+               << ", entries: " << counters.entries.load( std::memory_order_relaxed ) << "\n";
+    }
+    stream.flush();
+    return text;
+}
+
+bool Statistics::DumpToFile( QString const & filename, QJsonObject const & extra, QString & error ) const
+{
+    QSaveFile file{ filename };
+    if( !file.open( QIODevice::WriteOnly ) ){
+        error = file.errorString();
+        return false;
+    }
+    QJsonObject report = ToJson();
+    for( auto iter = extra.constBegin(); iter != extra.constEnd(); ++iter ) report.insert( iter.key(), iter.value() );
+    file.write( QJsonDocument( report ).toJson() );
+    if( !file.commit() ){
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
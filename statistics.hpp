@@ -0,0 +1,93 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QString>
+#include <atomic>
+
+// Process wide latency histograms and byte/entry counters for every I/O phase.
+// Everything is a relaxed atomic so any thread may record without locking, and
+// when disabled a ScopedTimer costs a single atomic load.
+class Statistics
+{
+public:
+    enum Phase {
+        ConfigLoad,
+        JsonParse,
+        HostsParse,
+        HostsRender,
+        FileWrite,  // writing a file out, along with whatever flush or sync to disk it takes
+        MenuBuild,
+        DnsQuery,   // one query through the embedded responder, relayed ones until they are sent
+        Startup,    // the window and tray coming up, the config loads after it
+        PhaseCount
+    };
+
+    // log2 buckets of microseconds: bucket i holds [2^(i-1), 2^i) us, bucket 0 anything under 1us
+    static int const s_bucket_count = 32;
+
+    static Statistics & Global();
+    static bool IsEnabled();
+    static void SetEnabled( bool enabled );
+    static QString PhaseName( Phase phase );
+
+    void RecordLatency( Phase phase, qint64 nanoseconds );
+    void AddBytesRead( Phase phase, qint64 bytes );
+    void AddBytesWritten( Phase phase, qint64 bytes );
+    void AddEntries( Phase phase, qint64 entries );
+    void Reset();
+
+    QJsonObject ToJson() const;
+    // the same as ToJson, as plain text for humans
+    QString     ToText() const;
+    // ToJson plus the keys of `extra`
+    bool        DumpToFile( QString const & filename, QJsonObject const & extra, QString & error ) const;
+private:
+    Statistics();
+
+    struct PhaseCounters {
+        std::atomic<quint64> count;
+        std::atomic<quint64> total_ns;
+        std::atomic<quint64> max_ns;
+        std::atomic<quint64> bytes_read;
+        std::atomic<quint64> bytes_written;
+        std::atomic<quint64> entries;
+        std::atomic<quint64> buckets[s_bucket_count];
+    };
+    // upper bound, in microseconds, of the bucket holding the q-th quantile
+    static quint64 Quantile( PhaseCounters const & counters, double q );
+
+    static std::atomic<bool> s_enabled;
+    PhaseCounters            phases[PhaseCount];
+};
+
+// times the enclosing scope into `phase`
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer( Statistics::Phase phase );
+    ~ScopedTimer();
+private:
+    ScopedTimer( ScopedTimer const & ) = delete;
+    ScopedTimer & operator=( ScopedTimer const & ) = delete;
+
+    Statistics::Phase phase;
+    bool              active;
+    QElapsedTimer     timer;
+};
+
+inline bool Statistics::IsEnabled() { return s_enabled.load( std::memory_order_relaxed ); }
+
+inline ScopedTimer::ScopedTimer( Statistics::Phase phase_ ): phase{ phase_ },
+    active{ Statistics::IsEnabled() }, timer{}
+{
+    if( active ) timer.start();
+}
+
+inline ScopedTimer::~ScopedTimer()
+{
+    if( active ) Statistics::Global().RecordLatency( phase, timer.nsecsElapsed() );
+}
+
+#endif // STATISTICS_HPP
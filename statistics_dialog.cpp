@@ -0,0 +1,72 @@
+#include "statistics_dialog.hpp"
+#include "config_writer.hpp"
+#include "statistics.hpp"
+#include "write_coalescer.hpp"
+#include <QFileDialog>
+#include <QFontDatabase>
+#include <QGridLayout>
+#include <QMessageBox>
+#include <QPlainTextEdit>
+#include <QPushButton>
+
+QString const statistics_title = "Statistics";
+
+statistics_dialog::statistics_dialog( WriteCoalescer const & coalescer, ConfigWriter const & writer, QWidget *parent ):
+    QDialog{ parent }, sync_coalescer{ coalescer }, config_writer{ writer }, text_edit{ nullptr }
+{
+    text_edit = new QPlainTextEdit();
+    text_edit->setReadOnly( true );
+    text_edit->setFont( QFontDatabase::systemFont( QFontDatabase::FixedFont ) );
+
+    QPushButton *refresh_button = new QPushButton( "Refresh" ),
+            *reset_button = new QPushButton( "Reset" ),
+            *save_button = new QPushButton( "Save as JSON..." );
+    QObject::connect( refresh_button, &QPushButton::clicked, [this]{ Refresh(); } );
+    QObject::connect( reset_button, &QPushButton::clicked, [this]{
+        Statistics::Global().Reset();
+        Refresh();
+    });
+    QObject::connect( save_button, &QPushButton::clicked, [this]{
+        QString const filename = QFileDialog::getSaveFileName( this, statistics_title, "statistics.json",
+                                                               "JSON files (*.json)" );
+        if( filename.isEmpty() ) return;
+        QString error {};
+        if( !Statistics::Global().DumpToFile( filename, SyncReport(), error ) ){
+            QMessageBox::critical( this, statistics_title, error );
+        }
+    });
+
+    QGridLayout *layout = new QGridLayout();
+    layout->addWidget( text_edit, 0, 0, 1, 3 );
+    layout->addWidget( refresh_button, 1, 0 );
+    layout->addWidget( reset_button, 1, 1 );
+    layout->addWidget( save_button, 1, 2 );
+    this->setLayout( layout );
+    this->setWindowTitle( statistics_title );
+    this->resize( 560, 480 );
+    Refresh();
+}
+
+QJsonObject statistics_dialog::SyncReport() const
+{
+    using Pair = QPair<QString, QJsonValue>;
+    WriteCoalescer::Counters const counters = sync_coalescer.GetCounters();
+    ConfigWriter::WriteCounts const written = config_writer.Written();
+    return QJsonObject( { Pair( "sync", QJsonObject( {
+        Pair( "config_requested", static_cast<double>( counters.config_requested ) ),
+        Pair( "config_performed", static_cast<double>( written.config_files ) ),
+        Pair( "hosts_requested", static_cast<double>( counters.hosts_requested ) ),
+        Pair( "hosts_performed", static_cast<double>( written.hosts_files ) )
+    }))});
+}
+
+void statistics_dialog::Refresh()
+{
+    WriteCoalescer::Counters const counters = sync_coalescer.GetCounters();
+    ConfigWriter::WriteCounts const written = config_writer.Written();
+    QString const syncs = QString( "syncs\n    config.json: %1 written of %2 requested"
+                                   ", hosts file: %3 written of %4 requested\n" )
+            .arg( written.config_files ).arg( counters.config_requested )
+            .arg( written.hosts_files ).arg( counters.hosts_requested );
+    text_edit->setPlainText( syncs + Statistics::Global().ToText() );
+}
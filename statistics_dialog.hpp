@@ -0,0 +1,29 @@
+#ifndef STATISTICS_DIALOG_HPP
+#define STATISTICS_DIALOG_HPP
+
+#include <QDialog>
+#include <QJsonObject>
+
+// forward declarations
+class QWidget;
+class QPlainTextEdit;
+class ConfigWriter;
+class WriteCoalescer;
+
+// shows Statistics::Global() plus the sync counters, and saves both as JSON
+class statistics_dialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    statistics_dialog( WriteCoalescer const & coalescer, ConfigWriter const & writer, QWidget *parent = nullptr );
+private:
+    void        Refresh();
+    QJsonObject SyncReport() const;
+
+    WriteCoalescer const & sync_coalescer;
+    ConfigWriter const &   config_writer;
+    QPlainTextEdit        *text_edit;
+};
+
+#endif // STATISTICS_DIALOG_HPP
@@ -0,0 +1,78 @@
+// A job still waiting in the writer's queue absorbs newer ones. Whatever it absorbs, the
+// journal files its config.json write folds in have to be the ones it discards.
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "config_writer.hpp"
+
+namespace {
+    QString JournalPath( QString const & config_path, quint64 generation )
+    {
+        return config_path + ".journal." + QString::number( generation );
+    }
+
+    // enough domains that writing them keeps the writer busy while the next jobs queue up
+    ConfigState BusyState( QString const & directory )
+    {
+        IpAddress address {};
+        IpAddress::Parse( "10.0.0.1", address );
+        ConfigState state{ directory + "/config.json", directory + "/hosts", {}, {}, {}, {}, 0, {} };
+        for( int a = 0; a != 64; ++a ){
+            Alias alias{ QString( "alias%1" ).arg( a ), address };
+            for( int d = 0; d != 2000; ++d ) alias.InsertDomainName( QString( "host%1.alias%2.test" ).arg( d ).arg( a ) );
+            state.aliases.insert( alias.Name(), alias );
+        }
+        return state;
+    }
+}
+
+class ConfigWriterTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void MergedJobKeepsNewestGeneration();
+};
+
+void ConfigWriterTest::MergedJobKeepsNewestGeneration()
+{
+    // the queue only merges jobs the writer hasn't picked up yet, try until it did
+    for( int attempt = 0; attempt != 20; ++attempt ){
+        QTemporaryDir directory {};
+        QVERIFY( directory.isValid() );
+        ConfigState const busy = BusyState( directory.path() );
+        for( quint64 generation = 1; generation != 5; ++generation ){
+            QFile journal{ JournalPath( busy.config_path, generation ) };
+            QVERIFY( journal.open( QIODevice::WriteOnly ) );
+        }
+
+        ConfigWriter writer {};
+        writer.Enqueue( busy, ConfigWriter::HostsFile );
+        // config.json rotated to generation 3, then a hosts file sync still carrying the
+        // generation the store was loaded with
+        ConfigState rotated = busy;
+        rotated.journal_generation = 3;
+        ConfigState synced = busy;
+        synced.journal_generation = 1;
+        quint64 const config_job = writer.Enqueue( rotated, ConfigWriter::ConfigFile );
+        quint64 const hosts_job = writer.Enqueue( synced, ConfigWriter::HostsFile );
+        QVERIFY( writer.WaitForIdle( 60000 ) );
+        if( config_job != hosts_job ) continue;
+
+        for( quint64 generation = 1; generation != 4; ++generation ){
+            QVERIFY2( !QFile::exists( JournalPath( busy.config_path, generation ) ),
+                      qPrintable( QString( "generation %1 survived" ).arg( generation ) ) );
+        }
+        QVERIFY( QFile::exists( JournalPath( busy.config_path, 4 ) ) );
+        QVERIFY( QFile::exists( busy.config_path ) );
+        QVERIFY( QFile::exists( busy.hosts_file_path ) );
+        return;
+    }
+    QSKIP( "the writer never left two jobs to merge" );
+}
+
+QTEST_GUILESS_MAIN( ConfigWriterTest )
+
+#include "config_writer_test.moc"
@@ -0,0 +1,101 @@
+// Every vectorized kernel has to split a hosts file into exactly the lines and fields
+// the scalar one does.
+
+#include <QByteArray>
+#include <QList>
+#include <QtTest>
+
+#include "hosts_scanner.hpp"
+
+namespace {
+    using Lines = QList<QList<QByteArray>>;
+
+    Lines ScanWith( HostsScanner::Kernel kernel, QByteArray const & data )
+    {
+        Lines lines {};
+        HostsScanner const scanner{ kernel };
+        scanner.Scan( data.constData(), static_cast<std::size_t>( data.size() ),
+                      [&]( HostsScanner::Field const * fields, std::size_t count ){
+            QList<QByteArray> line {};
+            for( std::size_t i = 0; i != count; ++i ){
+                line.append( data.mid( static_cast<int>( fields[i].offset ), static_cast<int>( fields[i].length ) ) );
+            }
+            lines.append( line );
+        });
+        return lines;
+    }
+}
+
+class HostsScannerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void ScalarFields_data();
+    void ScalarFields();
+    void KernelsMatchScalar_data();
+    void KernelsMatchScalar();
+};
+
+void HostsScannerTest::ScalarFields_data()
+{
+    QTest::addColumn<QByteArray>( "data" );
+    QTest::addColumn<Lines>( "expected" );
+
+    QTest::newRow( "crlf" ) << QByteArray( "127.0.0.1 a.com\r\n10.0.0.1\tb.com c.com\r\n" )
+                            << Lines{ { "127.0.0.1", "a.com" }, { "10.0.0.1", "b.com", "c.com" } };
+    QTest::newRow( "trailing comment" ) << QByteArray( "127.0.0.1 a.com # b.com\n# 10.0.0.1 c.com\n" )
+                                        << Lines{ { "127.0.0.1", "a.com" } };
+    QTest::newRow( "comment without blank" ) << QByteArray( "127.0.0.1 a.com#b.com\r\n" )
+                                             << Lines{ { "127.0.0.1", "a.com" } };
+    QTest::newRow( "no final newline" ) << QByteArray( "127.0.0.1 a.com\n::1 b.com" )
+                                        << Lines{ { "127.0.0.1", "a.com" }, { "::1", "b.com" } };
+    QTest::newRow( "blank lines" ) << QByteArray( "\n \t\r\n\n" ) << Lines{};
+}
+
+void HostsScannerTest::ScalarFields()
+{
+    QFETCH( QByteArray, data );
+    QFETCH( Lines, expected );
+    QCOMPARE( ScanWith( HostsScanner::Kernel::Scalar, data ), expected );
+}
+
+void HostsScannerTest::KernelsMatchScalar_data()
+{
+    QTest::addColumn<int>( "kernel" );
+    QTest::addColumn<QByteArray>( "data" );
+
+    QList<QPair<char const *, HostsScanner::Kernel>> const kernels {
+        { "sse2", HostsScanner::Kernel::SSE2 }, { "avx2", HostsScanner::Kernel::AVX2 } };
+    for( auto const & kernel: kernels ){
+        // every shift moves the fields, comments and line ends across the 64 byte blocks
+        for( int shift = 0; shift != 130; ++shift ){
+            QByteArray data( shift, ' ' );
+            data.append( "127.0.0.1\tlocalhost localhost.localdomain # loopback\r\n"
+                         "#10.0.0.1 commented.out.example.com\r\n"
+                         "10.0.0.2 a-rather-long-host-name-that-spans-more-than-one-block.example.com\r\n"
+                         "\r\n"
+                         "fe80::1%lo0 link-local#trailing\n"
+                         "  \t10.0.0.3\t\tlast.example.com" ); // no final newline
+            QTest::newRow( QString( "%1 shift %2" ).arg( kernel.first ).arg( shift ).toUtf8().constData() )
+                    << static_cast<int>( kernel.second ) << data;
+            data.append( "   # a comment that ends the file" );
+            QTest::newRow( QString( "%1 shift %2 comment at end" ).arg( kernel.first ).arg( shift ).toUtf8().constData() )
+                    << static_cast<int>( kernel.second ) << data;
+        }
+    }
+}
+
+void HostsScannerTest::KernelsMatchScalar()
+{
+    QFETCH( int, kernel );
+    QFETCH( QByteArray, data );
+    HostsScanner::Kernel const tested = static_cast<HostsScanner::Kernel>( kernel );
+    if( !HostsScanner::IsSupported( tested ) ) QSKIP( "kernel not supported by this CPU or build" );
+    QCOMPARE( HostsScanner{ tested }.ActiveKernel(), tested );
+    QCOMPARE( ScanWith( tested, data ), ScanWith( HostsScanner::Kernel::Scalar, data ) );
+}
+
+QTEST_APPLESS_MAIN( HostsScannerTest )
+
+#include "hosts_scanner_test.moc"
@@ -0,0 +1,14 @@
+QT       += core concurrent network testlib
+QT       -= gui
+
+CONFIG   += console testcase
+CONFIG   -= app_bundle
+
+TARGET = hosts_scanner_test
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../../core.pri)
+
+SOURCES += hosts_scanner_test.cpp
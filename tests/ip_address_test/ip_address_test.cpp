@@ -0,0 +1,105 @@
+// Addresses are parsed once and compared as integers everywhere after, so whatever
+// Parse accepts has to print back in one canonical form and sort numerically.
+
+#include <QString>
+#include <QtTest>
+
+#include "ip_address.hpp"
+
+class IpAddressTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void RoundTrip_data();
+    void RoundTrip();
+    void Rejected_data();
+    void Rejected();
+    void Ordering();
+};
+
+void IpAddressTest::RoundTrip_data()
+{
+    QTest::addColumn<QString>( "text" );
+    QTest::addColumn<QString>( "expected" );
+    QTest::addColumn<bool>( "v4" );
+
+    QTest::newRow( "dotted quad" ) << "10.0.0.1" << "10.0.0.1" << true;
+    QTest::newRow( "leading zeros are decimal" ) << "010.000.000.001" << "10.0.0.1" << true;
+    QTest::newRow( "surrounding blanks" ) << " 192.168.1.1\t" << "192.168.1.1" << true;
+    QTest::newRow( "mapped v4" ) << "::ffff:10.0.0.1" << "10.0.0.1" << true;
+    QTest::newRow( "unspecified" ) << "::" << "::" << false;
+    QTest::newRow( "loopback" ) << "::1" << "::1" << false;
+    QTest::newRow( "trailing gap" ) << "1::" << "1::" << false;
+    QTest::newRow( "uppercase and zeros" ) << "2001:0DB8:0000:0000:0000:FF00:0042:8329"
+                                           << "2001:db8::ff00:42:8329" << false;
+    QTest::newRow( "first run on a tie" ) << "2001:db8:0:0:1:0:0:1" << "2001:db8::1:0:0:1" << false;
+    QTest::newRow( "single zero group stays" ) << "1:0:1:1:1:1:1:1" << "1:0:1:1:1:1:1:1" << false;
+    QTest::newRow( "gap of one group" ) << "1:2:3:4:5:6:7::" << "1:2:3:4:5:6:7:0" << false;
+    QTest::newRow( "v4 tail" ) << "64:ff9b::192.0.2.33" << "64:ff9b::c000:221" << false;
+}
+
+void IpAddressTest::RoundTrip()
+{
+    QFETCH( QString, text );
+    QFETCH( QString, expected );
+    QFETCH( bool, v4 );
+
+    IpAddress address {};
+    QVERIFY( IpAddress::Parse( text, address ) );
+    QCOMPARE( address.ToString(), expected );
+    QCOMPARE( address.IsV4(), v4 );
+
+    // the canonical form parses back to the same bits
+    IpAddress reparsed {};
+    QVERIFY( IpAddress::Parse( expected, reparsed ) );
+    QVERIFY( reparsed == address );
+}
+
+void IpAddressTest::Rejected_data()
+{
+    QTest::addColumn<QString>( "text" );
+
+    QTest::newRow( "empty" ) << "";
+    QTest::newRow( "name" ) << "localhost";
+    QTest::newRow( "zone" ) << "fe80::1%eth0";
+    QTest::newRow( "octet too large" ) << "256.0.0.1";
+    QTest::newRow( "three octets" ) << "1.2.3";
+    QTest::newRow( "five octets" ) << "1.2.3.4.5";
+    QTest::newRow( "four digit octet" ) << "1.2.3.0004";
+    QTest::newRow( "nine groups" ) << "1:2:3:4:5:6:7:8:9";
+    QTest::newRow( "two gaps" ) << "1::2::3";
+    QTest::newRow( "gap after eight groups" ) << "1:2:3:4:5:6:7:8::";
+    QTest::newRow( "leading single colon" ) << ":1::2";
+    QTest::newRow( "trailing single colon" ) << "1:2:3:4:5:6:7:";
+    QTest::newRow( "five digit group" ) << "12345::";
+    QTest::newRow( "v4 tail too late" ) << "1:2:3:4:5:6:7:1.2.3.4";
+}
+
+void IpAddressTest::Rejected()
+{
+    QFETCH( QString, text );
+    IpAddress address {};
+    QVERIFY( !IpAddress::Parse( text, address ) );
+}
+
+void IpAddressTest::Ordering()
+{
+    auto parse = []( char const * text ){
+        IpAddress address {};
+        if( !IpAddress::Parse( QString::fromLatin1( text ), address ) ) qFatal( "unparsable test address %s", text );
+        return address;
+    };
+    QVERIFY( parse( "10.0.0.2" ) < parse( "10.0.0.10" ) );
+    QVERIFY( parse( "9.255.255.255" ) < parse( "10.0.0.0" ) );
+    // every IPv4 address sorts together, between ::1 and the global IPv6 ones
+    QVERIFY( parse( "::1" ) < parse( "0.0.0.0" ) );
+    QVERIFY( parse( "255.255.255.255" ) < parse( "2001:db8::1" ) );
+    QVERIFY( parse( "::ffff:10.0.0.1" ) == parse( "10.0.0.1" ) );
+    QVERIFY( parse( "::1" ) != parse( "::2" ) );
+    QCOMPARE( qHash( parse( "10.0.0.1" ) ), qHash( parse( "::ffff:a00:1" ) ) );
+}
+
+QTEST_APPLESS_MAIN( IpAddressTest )
+
+#include "ip_address_test.moc"
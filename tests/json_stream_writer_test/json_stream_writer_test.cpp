@@ -0,0 +1,96 @@
+// config.json is streamed out without ever building a QJsonDocument, yet has to come out
+// byte for byte as QJsonDocument::toJson() would have written it.
+
+#include <QBuffer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtTest>
+
+#include "json_stream_writer.hpp"
+
+namespace {
+    // strings, arrays and objects only, the writer has no other values
+    void Stream( JsonStreamWriter & json, QJsonValue const & value )
+    {
+        if( value.isArray() ){
+            json.BeginArray();
+            for( auto const & item: value.toArray() ) Stream( json, item );
+            json.EndArray();
+        } else if( value.isObject() ){
+            QJsonObject const object = value.toObject();
+            json.BeginObject();
+            // QJsonObject iterates in key order, the order toJson() writes them in
+            for( auto iter = object.begin(); iter != object.end(); ++iter ){
+                json.Key( iter.key().toLatin1().constData() );
+                Stream( json, iter.value() );
+            }
+            json.EndObject();
+        } else {
+            json.Value( value.toString() );
+        }
+    }
+
+    QJsonObject AliasObject( char const * ip, char const * name, QJsonArray const & domains )
+    {
+        return QJsonObject{ { "ip", ip }, { "name", name }, { "pointing_to", domains } };
+    }
+}
+
+class JsonStreamWriterTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void MatchesQt_data();
+    void MatchesQt();
+};
+
+void JsonStreamWriterTest::MatchesQt_data()
+{
+    QTest::addColumn<QJsonDocument>( "document" );
+    QTest::addColumn<int>( "buffer_size" );
+
+    QJsonDocument const config{ QJsonObject{
+        { "aliases", QJsonArray{
+              AliasObject( "10.0.0.1", "local", QJsonArray{ "a.test", "b.test" } ),
+              AliasObject( "10.0.0.2", "unused", QJsonArray{} ),
+              QJsonObject{ { "ip", "::1" }, { "name", "rules" }, { "pointing_to", QJsonArray{} },
+                           { "wildcards", QJsonArray{ QJsonObject{ { "hosts", QJsonArray{} },
+                                                                   { "pattern", "*.staging.test" } } } } } } },
+        { "hosts_file", "C:\\Windows\\System32\\drivers\\etc\\hosts" },
+        { "profiles", QJsonObject{} } } };
+    QTest::newRow( "config" ) << config << JsonStreamWriter::s_default_buffer_size;
+    // every value crosses a flush
+    QTest::newRow( "tiny buffer" ) << config << 3;
+
+    QTest::newRow( "empty array" ) << QJsonDocument{ QJsonArray{} } << JsonStreamWriter::s_default_buffer_size;
+    QTest::newRow( "empty object" ) << QJsonDocument{ QJsonObject{} } << JsonStreamWriter::s_default_buffer_size;
+    QTest::newRow( "nested empties" ) << QJsonDocument{ QJsonArray{ QJsonArray{}, QJsonObject{},
+                                                                    QJsonArray{ QJsonArray{} } } }
+                                      << JsonStreamWriter::s_default_buffer_size;
+    QTest::newRow( "escapes" ) << QJsonDocument{ QJsonArray{ "quote \" backslash \\ slash /",
+                                                             "\b\f\n\r\t", QString( QChar( 0x01 ) ) + QChar( 0x1f ),
+                                                             QString::fromUtf8( "caf\xc3\xa9 \xe2\x82\xac" ) } }
+                               << JsonStreamWriter::s_default_buffer_size;
+}
+
+void JsonStreamWriterTest::MatchesQt()
+{
+    QFETCH( QJsonDocument, document );
+    QFETCH( int, buffer_size );
+
+    QBuffer device {};
+    QVERIFY( device.open( QIODevice::WriteOnly ) );
+    JsonStreamWriter json{ device, buffer_size };
+    Stream( json, document.isArray() ? QJsonValue{ document.array() } : QJsonValue{ document.object() } );
+    QVERIFY( json.Finish() );
+
+    QByteArray const expected = document.toJson( QJsonDocument::Indented );
+    QCOMPARE( device.data(), expected );
+    QCOMPARE( json.BytesWritten(), static_cast<qint64>( expected.size() ) );
+}
+
+QTEST_APPLESS_MAIN( JsonStreamWriterTest )
+
+#include "json_stream_writer_test.moc"
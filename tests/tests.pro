@@ -0,0 +1,13 @@
+#-------------------------------------------------
+#
+# Unit tests for the GUI-free core. Build with qmake && make, run with
+# make check.
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += config_writer_test \
+           hosts_scanner_test \
+           ip_address_test \
+           json_stream_writer_test
@@ -0,0 +1,38 @@
+#include "write_coalescer.hpp"
+#include "config_writer.hpp"
+
+int const WriteCoalescer::s_default_window_ms = 250;
+
+WriteCoalescer::WriteCoalescer( int window_ms, QObject *parent ): QObject{ parent },
+    timer{}, pending_targets{ 0 }, counters{}
+{
+    timer.setSingleShot( true );
+    timer.setInterval( window_ms );
+    QObject::connect( &timer, &QTimer::timeout, this, &WriteCoalescer::OnTimeout );
+}
+
+void WriteCoalescer::MarkDirty( int targets )
+{
+    if( targets & ConfigWriter::ConfigFile ) ++counters.config_requested;
+    if( targets & ConfigWriter::HostsFile ) ++counters.hosts_requested;
+    pending_targets |= targets;
+    if( !timer.isActive() ) timer.start();
+}
+
+void WriteCoalescer::FlushNow()
+{
+    timer.stop();
+    OnTimeout();
+}
+
+void WriteCoalescer::OnTimeout()
+{
+    if( !pending_targets ) return;
+    int const targets = pending_targets;
+    pending_targets = 0;
+    emit Flush( targets );
+}
+
+void WriteCoalescer::SetWindow( int window_ms ) { timer.setInterval( window_ms ); }
+int WriteCoalescer::Window() const { return timer.interval(); }
+WriteCoalescer::Counters WriteCoalescer::GetCounters() const { return counters; }
@@ -0,0 +1,45 @@
+#ifndef WRITE_COALESCER_HPP
+#define WRITE_COALESCER_HPP
+
+#include <QObject>
+#include <QTimer>
+
+// Collects "this needs writing" marks and turns every burst of them into a single
+// Flush per target. The first mark arms a timer, anything marked before it fires
+// rides along, so a write is never delayed by more than the window.
+class WriteCoalescer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // marks taken; how many writes they turned into is ConfigWriter::Written()
+    struct Counters {
+        quint64 config_requested;
+        quint64 hosts_requested;
+    };
+
+    explicit WriteCoalescer( int window_ms, QObject *parent = nullptr );
+
+    // `targets` are ConfigWriter::Target bits
+    void     MarkDirty( int targets );
+    // emits whatever is pending right away
+    void     FlushNow();
+    void     SetWindow( int window_ms );
+    int      Window() const;
+    Counters GetCounters() const;
+
+    static int const s_default_window_ms;
+
+signals:
+    void Flush( int targets );
+
+private slots:
+    void OnTimeout();
+
+private:
+    QTimer   timer;
+    int      pending_targets;
+    Counters counters;
+};
+
+#endif // WRITE_COALESCER_HPP